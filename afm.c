@@ -16,6 +16,45 @@
 
 #include "afm.h"
 #include "encoding.h"
+#include "pdf.h"
+
+/*
+ * Memo of parsed markup, per afm_t.  It is dropped as a whole once it
+ * holds AFM_MARKUP_CACHE_SIZE strings, entries still in use live on
+ * until their last reference goes.
+ */
+#define AFM_MARKUP_CACHE_SIZE	1024
+
+typedef struct {
+	gint		start;
+	gint		end;
+	double		fscale;
+	double		rise;
+} afm_run_t;
+
+/*
+ * Not changed once parsed, so it is used without a lock.
+ */
+typedef struct {
+	gint		ref;
+	unsigned char	*text;		/* ISO-8859-1, without markup */
+	gsize		len;
+	GArray		*runs;		/* afm_run_t */
+	afm_extents_t	extents;	/* at scale 1000 */
+} afm_markup_t;
+
+static void
+afm_markup_unref(gpointer data)
+{
+	afm_markup_t *m = data;
+
+	if (!g_atomic_int_dec_and_test(&m->ref))
+		return;
+
+	g_free(m->text);
+	g_array_free(m->runs, TRUE);
+	g_free(m);
+}
 
 static __inline__ unsigned int
 afm_name_hash(const char *name, unsigned int len)
@@ -201,6 +240,75 @@ afm_lookup_kern(afm_t *afm, char_t *ch0, char_t *ch1)
 	return NULL;
 }
 
+static __inline__ int
+afm_char_encoded(afm_t *afm, char_t *ch)
+{
+	return ch && (afm->char_table[ch->index].ch == ch);
+}
+
+/*
+ * Kerning and ligatures by char_table index, so text layout needs no
+ * hash lookups per character pair.
+ */
+static void
+afm_set_pair_tables(afm_t *afm)
+{
+	ligature_t *lig;
+	kern_t *kern;
+	unsigned int i;
+
+	memset(afm->kern_table, 0, sizeof(afm->kern_table));
+	memset(afm->ligature_table, 0, sizeof(afm->ligature_table));
+
+	for (i = 0; i < KERN_HASH_SIZE; i++) {
+		for (kern = afm->kern_hash[i]; kern;
+		     kern = kern->next_by_chars) {
+			if (!afm_char_encoded(afm, kern->chars[0]) ||
+			    !afm_char_encoded(afm, kern->chars[1]))
+				continue;
+
+			afm->kern_table[kern->chars[0]->index]
+				       [kern->chars[1]->index] = kern->value;
+		}
+	}
+
+	for (i = 0; i < LIGATURE_HASH_SIZE; i++) {
+		for (lig = afm->ligature_hash[i]; lig;
+		     lig = lig->next_by_chars) {
+			if (!afm_char_encoded(afm, lig->chars[0]) ||
+			    !afm_char_encoded(afm, lig->chars[1]) ||
+			    !afm_char_encoded(afm, lig->ch))
+				continue;
+
+			afm->ligature_table[lig->chars[0]->index]
+					   [lig->chars[1]->index] = lig->ch->index;
+		}
+	}
+}
+
+/*
+ * Give 'ch' the first free code from 128 on.
+ */
+int
+afm_encode_char(afm_t *afm, char_t *ch)
+{
+	unsigned int c = 128;
+
+	while ((c < 256) && afm->char_table[c].ch)
+		c++;
+	if (c == 256) {
+		fprintf(stderr, "%s:%u: no free code for '%s'\n",
+			__FUNCTION__, __LINE__, ch->name);
+		return -1;
+	}
+
+	ch->index = c;
+	afm->char_table[c].ch = ch;
+
+	afm_set_pair_tables(afm);
+	return c;
+}
+
 int
 afm_read_file(const char *filename, afm_t **afmp)
 {
@@ -229,6 +337,7 @@ afm_read_file(const char *filename, afm_t **afmp)
 		return -1;
 	}
 	memset(afm, 0, sizeof(afm_t));
+	g_static_mutex_init(&afm->markup_lock);
 
 	line = buffer;
 	while (NULL != (p = strchr(line, '\n'))) {
@@ -559,8 +668,117 @@ afm_read_file(const char *filename, afm_t **afmp)
 		}
 	}
 
+	afm_set_pair_tables(afm);
+
+	*afmp = afm;
+	return 0;
+}
+
+static char *
+afm_strdup(const char *s)
+{
+	return s ? strdup(s) : NULL;
+}
+
+/*
+ * Same afm_t as afm_read_file() gives, built from a table generated
+ * by afmgen.
+ */
+int
+afm_from_table(const afm_font_data_t *data, afm_t **afmp)
+{
+	const afm_char_data_t *cd;
+	ligature_t *lig;
+	kern_t *kern;
+	char_t *ch;
+	afm_t *afm;
+	unsigned int i;
+
+	afm = malloc(sizeof(afm_t));
+	if (NULL == afm) {
+		fprintf(stderr, "%s:%u: afm: %s\n",
+			__FUNCTION__, __LINE__, strerror(ENOMEM));
+		return -1;
+	}
+	memset(afm, 0, sizeof(afm_t));
+	g_static_mutex_init(&afm->markup_lock);
+
+	afm->font_name = afm_strdup(data->font_name);
+	afm->full_name = afm_strdup(data->full_name);
+	afm->family_name = afm_strdup(data->family_name);
+	afm->weight = afm_strdup(data->weight);
+
+	afm->font_ascent = data->font_ascent;
+	afm->font_descent = data->font_descent;
+
+	for (i = 0; i < data->nr_chars; i++) {
+		cd = &data->chars[i];
+
+		ch = malloc(sizeof(char_t));
+		if (NULL == ch)
+			goto nomem;
+		memset(ch, 0, sizeof(char_t));
+
+		ch->name = strdup(cd->name);
+		if (NULL == ch->name) {
+			afm_free_char_data(ch);
+			goto nomem;
+		}
+		ch->width = cd->width;
+		ch->bbox = cd->bbox;
+
+		afm_insert_char_data(afm, ch);
+
+		if (cd->index >= 0) {
+			ch->index = cd->index;
+			afm->char_table[ch->index].ch = ch;
+		}
+	}
+
+	for (i = 0; i < data->nr_ligatures; i++) {
+		lig = malloc(sizeof(ligature_t));
+		if (NULL == lig)
+			goto nomem;
+		memset(lig, 0, sizeof(ligature_t));
+
+		lig->name[0] = strdup(data->ligatures[i].name[0]);
+		lig->name[1] = strdup(data->ligatures[i].name[1]);
+		lig->ligature = strdup(data->ligatures[i].ligature);
+		if (!lig->name[0] || !lig->name[1] || !lig->ligature) {
+			afm_free_ligature_data(lig);
+			goto nomem;
+		}
+
+		afm_insert_ligature_data(afm, lig);
+	}
+
+	for (i = 0; i < data->nr_kerns; i++) {
+		kern = malloc(sizeof(kern_t));
+		if (NULL == kern)
+			goto nomem;
+		memset(kern, 0, sizeof(kern_t));
+
+		kern->name[0] = strdup(data->kerns[i].name[0]);
+		kern->name[1] = strdup(data->kerns[i].name[1]);
+		if (!kern->name[0] || !kern->name[1]) {
+			afm_free_kern_data(kern);
+			goto nomem;
+		}
+		kern->value = data->kerns[i].value;
+
+		afm_insert_kern_data(afm, kern);
+	}
+
+	afm_set_pair_tables(afm);
+
 	*afmp = afm;
 	return 0;
+
+nomem:
+	fprintf(stderr, "%s:%u: %s: out of memory\n",
+		__FUNCTION__, __LINE__, data->font_name);
+	afm_free(afm);
+	return -1;
 }
 
 void
@@ -603,11 +821,15 @@ afm_free(afm_t *afm)
 		free(afm->family_name);
 	if (afm->weight)
 		free(afm->weight);
+
+	if (afm->markup_cache)
+		g_hash_table_destroy(afm->markup_cache);
+	g_static_mutex_free(&afm->markup_lock);
 }
 
 static void
 afm_add_char_extents(afm_extents_t *extents, int *first,
-		     char_t *ch, kern_t *kern, double scale, double rise)
+		     char_t *ch, int kern, double scale, double rise)
 {
 	double llx = ((double) ch->bbox.llx) * scale;
 	double lly = ((double) ch->bbox.lly) * scale;
@@ -633,8 +855,7 @@ afm_add_char_extents(afm_extents_t *extents, int *first,
 		return;
 	}
 
-	if (kern)
-		extents->width += ((double) kern->value) * scale;
+	extents->width += ((double) kern) * scale;
 
 	if (extents->width + llx < extents->bbox.llx)
 		extents->bbox.llx = extents->width + llx;
@@ -661,8 +882,8 @@ afm_add_string_extents(afm_extents_t *extents, afm_t *afm,
 		       double scale, double rise)
 {
 	char_t *this, *next;
-	kern_t *kern = NULL;
-	ligature_t *lig;
+	unsigned int lig;
+	int kern = 0;
 	unsigned int i;
 
 	this = afm->char_table[((unsigned int)text[start])].ch;
@@ -670,9 +891,9 @@ afm_add_string_extents(afm_extents_t *extents, afm_t *afm,
 	for (i = start + 1; i < end; i++) {
 		next = afm->char_table[((unsigned int)text[i])].ch;
 
-		lig = afm_lookup_ligature(afm, this, next);
-		if (NULL != lig) {
-			this = lig->ch;
+		lig = afm->ligature_table[this->index][next->index];
+		if (lig) {
+			this = afm->char_table[lig].ch;
 			if (++i == end)
 				break;
 			next = afm->char_table[((unsigned int)text[i])].ch;
@@ -680,7 +901,7 @@ afm_add_string_extents(afm_extents_t *extents, afm_t *afm,
 
 		afm_add_char_extents(extents, first, this, kern, scale, rise);
 
-		kern = afm_lookup_kern(afm, this, next);
+		kern = afm->kern_table[this->index][next->index];
 
 		this = next;
 	}
@@ -690,28 +911,30 @@ afm_add_string_extents(afm_extents_t *extents, afm_t *afm,
 	return this;
 }
 
-int
-afm_text_extents(afm_t *afm, double scale,
-		 const char *markup, size_t len, afm_extents_t *extents)
+/*
+ * Markup as ISO-8859-1 text and attribute runs, measured at scale 1000.
+ * 'markup' is 'len' bytes followed by a '\0'.
+ */
+static afm_markup_t *
+afm_parse_markup(afm_t *afm, const char *markup, size_t len)
 {
 	PangoAttrList *attr_list;
 	PangoAttrIterator *iter;
 	GSList *alist, *anext;
 	PangoAttribute *attr;
-	double rise, fscale;
-	gint start, end;
+	afm_markup_t *m;
+	afm_run_t run;
 	char *utf8_markup;
 	char *utf8_text;
-	unsigned char *text;
 	int first = 1;
+	int i;
 
 	utf8_markup = g_convert(markup, len, "UTF-8", "ISO-8859-1",
 				NULL, &len, NULL);
 	if (NULL == utf8_markup) {
 		fprintf(stderr, "%s: g_convert to UTF-8 failed for '%s'\n",
 			__FUNCTION__, markup);
-		g_free(utf8_markup);
-		return 0;
+		return NULL;
 	}
 
 	if (!pango_parse_markup(utf8_markup, -1, 0,
@@ -719,34 +942,40 @@ afm_text_extents(afm_t *afm, double scale,
 		fprintf(stderr, "%s: pango_parse_markup failed for '%s'\n",
 			__FUNCTION__, markup);
 		g_free(utf8_markup);
-		return 0;
+		return NULL;
 	}
 	g_free(utf8_markup);
 
-	text = (unsigned char *) g_convert(utf8_text, -1, "ISO-8859-1", "UTF-8",
-					   NULL, &len, NULL);
-	if (NULL == text) {
+	m = g_new0(afm_markup_t, 1);
+
+	m->text = (unsigned char *) g_convert(utf8_text, -1,
+					      "ISO-8859-1", "UTF-8",
+					      NULL, &m->len, NULL);
+	if (NULL == m->text) {
 		fprintf(stderr, "%s: g_convert to ISO_8859_1 failed for '%s'\n",
 			__FUNCTION__, utf8_text);
+		pango_attr_list_unref(attr_list);
 		g_free(utf8_text);
-		return 0;
+		g_free(m);
+		return NULL;
 	}
 	g_free(utf8_text);
 
-	memset(extents, 0, sizeof(afm_extents_t));
+	m->ref = 1;
+	m->runs = g_array_new(FALSE, FALSE, sizeof(afm_run_t));
 
-	if (0 == len)
+	if (0 == m->len)
 		goto out;
 
 	iter = pango_attr_list_get_iterator(attr_list);
 	do {
-		pango_attr_iterator_range(iter, &start, &end);
+		pango_attr_iterator_range(iter, &run.start, &run.end);
 
-		if (end > len)
-			end = len;
+		if (run.end > m->len)
+			run.end = m->len;
 
-		fscale = 1.0;
-		rise = 0.0;
+		run.fscale = 1.0;
+		run.rise = 0.0;
 
 		alist = pango_attr_iterator_get_attrs(iter);
 
@@ -760,13 +989,13 @@ afm_text_extents(afm_t *afm, double scale,
 			case PANGO_ATTR_RISE:
 			{
 				PangoAttrInt *arise = (void *) attr;
-				rise = ((double) arise->value) / 10000.0;
+				run.rise = ((double) arise->value) / 10000.0;
 				break;
 			}
 			case PANGO_ATTR_SCALE:
 			{
 				PangoAttrFloat *ascale = (void *) attr;
-				fscale = ascale->value;
+				run.fscale = ascale->value;
 				break;
 			}
 			default:
@@ -781,17 +1010,111 @@ afm_text_extents(afm_t *afm, double scale,
 			alist = anext;
 		}
 
-		afm_add_string_extents(extents, afm, text, &first,
-				       start, end, fscale,
-				       afm->font_ascent * rise);
+		g_array_append_val(m->runs, run);
 
-		if (end == len)
+		if (run.end == m->len)
 			break;
 
 	} while (TRUE == pango_attr_iterator_next(iter));
 
 	pango_attr_iterator_destroy(iter);
 
+out:
+	pango_attr_list_unref(attr_list);
+
+	for (i = 0; i < m->runs->len; i++) {
+		run = g_array_index(m->runs, afm_run_t, i);
+
+		afm_add_string_extents(&m->extents, afm, m->text, &first,
+				       run.start, run.end, run.fscale,
+				       afm->font_ascent * run.rise);
+	}
+
+	return m;
+}
+
+/*
+ * Parsed markup from the memo of afm, parsed and added if missing.
+ * markup_lock is held for the lookup and the insertion only.  Release
+ * the result with afm_markup_unref().
+ */
+static afm_markup_t *
+afm_lookup_markup(afm_t *afm, const char *markup, size_t len)
+{
+	GHashTable *full = NULL;
+	afm_markup_t *m, *old;
+	char *key;
+
+	key = g_strndup(markup, len);
+
+	g_static_mutex_lock(&afm->markup_lock);
+	m = NULL;
+	if (afm->markup_cache)
+		m = g_hash_table_lookup(afm->markup_cache, key);
+	if (m)
+		g_atomic_int_inc(&m->ref);
+	g_static_mutex_unlock(&afm->markup_lock);
+
+	if (m) {
+		g_free(key);
+		return m;
+	}
+
+	m = afm_parse_markup(afm, key, len);
+	if (NULL == m) {
+		g_free(key);
+		return NULL;
+	}
+
+	g_static_mutex_lock(&afm->markup_lock);
+
+	if (afm->markup_cache &&
+	    g_hash_table_size(afm->markup_cache) >= AFM_MARKUP_CACHE_SIZE) {
+		full = afm->markup_cache;
+		afm->markup_cache = NULL;
+	}
+	if (NULL == afm->markup_cache)
+		afm->markup_cache = g_hash_table_new_full(g_str_hash,
+							  g_str_equal,
+							  g_free,
+							  afm_markup_unref);
+
+	/* parsed by another thread meanwhile */
+	old = g_hash_table_lookup(afm->markup_cache, key);
+	if (old) {
+		g_atomic_int_inc(&old->ref);
+		g_static_mutex_unlock(&afm->markup_lock);
+
+		afm_markup_unref(m);
+		g_free(key);
+		m = old;
+		goto out;
+	}
+
+	g_atomic_int_inc(&m->ref);
+	g_hash_table_insert(afm->markup_cache, key, m);
+
+	g_static_mutex_unlock(&afm->markup_lock);
+
+out:
+	/* entries still in use by other threads keep their own reference */
+	if (full)
+		g_hash_table_destroy(full);
+	return m;
+}
+
+int
+afm_text_extents(afm_t *afm, double scale,
+		 const char *markup, size_t len, afm_extents_t *extents)
+{
+	afm_markup_t *m;
+
+	m = afm_lookup_markup(afm, markup, len);
+	if (NULL == m)
+		return 0;
+
+	*extents = m->extents;
+	afm_markup_unref(m);
 
 	extents->bbox.ury *= scale / 1000.0;
 	extents->bbox.lly *= scale / 1000.0;
@@ -803,54 +1126,52 @@ afm_text_extents(afm_t *afm, double scale,
 	extents->bbox.llx *= scale / 1000.0;
 	extents->bbox.urx *= scale / 1000.0;
 
-out:
-	pango_attr_list_unref(attr_list);
-	g_free(text);
-
 	return extents->width;
 }
 
-static int
-afm_output_char(FILE *file, kern_t *kern, unsigned int c)
+static void
+afm_output_char(pdf_t *pdf, int kern, unsigned int c)
 {
-	int output = 0;
-
-	if (kern && (0 != kern->value))
-		output += fprintf(file, ") %d (", -kern->value);
+	if (kern)
+		pdf_printf(pdf, ") %d (", -kern);
 
 	if ((c < 128) && isprint(c)) {
 		switch (c) {
 		case '(':
 		case ')':
 		case '\\':
-			output += fprintf(file, "\\%c", c);
+			pdf_putc(pdf, '\\');
+			pdf_putc(pdf, c);
 			break;
 		default:
-			output += fprintf(file, "%c", c);
+			pdf_putc(pdf, c);
 			break;
 		}
 
-		return output;
+		return;
 	}
 
-	output += fprintf(file, "\\%03o", c);
-	return output;
+	pdf_putc(pdf, '\\');
+	pdf_putc(pdf, '0' + ((c >> 6) & 7));
+	pdf_putc(pdf, '0' + ((c >> 3) & 7));
+	pdf_putc(pdf, '0' + (c & 7));
 }
 
-static int
-afm_output_string(FILE *file, afm_t *afm, const unsigned char *text,
+static void
+afm_output_string(pdf_t *pdf, afm_t *afm, const unsigned char *text,
 		  unsigned int start, unsigned int end,
 		  double scale, double rise)
 {
 	char_t *this, *next;
-	kern_t *kern = NULL;
-	ligature_t *lig;
+	unsigned int lig;
+	int kern = 0;
 	unsigned int i;
-	int offset = 0;
 
-	offset += fprintf(file, "   /%s %.3f Tf\n", afm->pdf_name, scale);
-	offset += fprintf(file, "   %.3f Ts\n", rise);
-	offset += fprintf(file, "   [ (");
+	pdf_printf(pdf, "   /%s ", afm->pdf_name);
+	pdf_op1(pdf, scale, "Tf");
+	pdf_puts(pdf, "   ");
+	pdf_op1(pdf, rise, "Ts");
+	pdf_puts(pdf, "   [ (");
 
 	this = afm->char_table[((unsigned int)text[start])].ch;
 
@@ -858,135 +1179,55 @@ afm_output_string(FILE *file, afm_t *afm, const unsigned char *text,
 
 		next = afm->char_table[((unsigned int)text[i])].ch;
 
-		lig = afm_lookup_ligature(afm, this, next);
-		if (NULL != lig) {
-			this = lig->ch;
+		lig = afm->ligature_table[this->index][next->index];
+		if (lig) {
+			this = afm->char_table[lig].ch;
 			if (++i == end)
 				break;
 			next = afm->char_table[((unsigned int)text[i])].ch;
 		}
 
-		offset += afm_output_char(file, kern, this->index);
+		afm_output_char(pdf, kern, this->index);
 
-		kern = afm_lookup_kern(afm, this, next);
+		kern = afm->kern_table[this->index][next->index];
 
 		this = next;
 	}
 
-	offset += afm_output_char(file, kern, this->index);
+	afm_output_char(pdf, kern, this->index);
 
-	offset += fprintf(file, ") ] TJ\n");
-	return offset;
+	pdf_puts(pdf, ") ] TJ\n");
 }
 
-int
-afm_print_text(FILE *file, afm_t *afm, double scale, double x, double y,
+void
+afm_print_text(pdf_t *pdf, afm_t *afm, double scale, double x, double y,
 	       const char *markup, size_t len)
 {
-	PangoAttrList *attr_list;
-	PangoAttrIterator *iter;
-	GSList *alist, *anext;
-	PangoAttribute *attr;
-	double rise, fscale;
-	gint start, end;
-	char *utf8_markup;
-	char *utf8_text;
-	unsigned char *text;
-	int offset = 0;
+	afm_markup_t *m;
+	afm_run_t *run;
+	int i;
 
-	utf8_markup = g_convert(markup, len, "UTF-8", "ISO-8859-1",
-				NULL, &len, NULL);
-	if (NULL == utf8_markup) {
-		fprintf(stderr, "%s: g_convert to UTF-8 failed for '%s'\n",
-			__FUNCTION__, markup);
-		g_free(utf8_markup);
-		return 0;
-	}
-
-	if (!pango_parse_markup(utf8_markup, -1, 0,
-				&attr_list, &utf8_text, NULL, NULL)) {
-		fprintf(stderr, "%s: pango_parse_markup failed for '%s'\n",
-			__FUNCTION__, markup);
-		g_free(utf8_markup);
-		return 0;
-	}
-	g_free(utf8_markup);
-
-	text = (unsigned char *) g_convert(utf8_text, -1, "ISO-8859-1", "UTF-8",
-					   NULL, &len, NULL);
-	if (NULL == text) {
-		fprintf(stderr, "%s: g_convert to ISO_8859_1 failed for '%s'\n",
-			__FUNCTION__, utf8_text);
-		g_free(utf8_text);
-		return 0;
-	}
-	g_free(utf8_text);
-
-	if (0 == len)
+	m = afm_lookup_markup(afm, markup, len);
+	if (NULL == m)
+		return;
+	if (0 == m->len)
 		goto out;
 
-	offset += fprintf(file, "BT\n");
-	offset += fprintf(file, "   %.3f %.3f Td\n", x, y);
-
-	iter = pango_attr_list_get_iterator(attr_list);
-	do {
-		pango_attr_iterator_range(iter, &start, &end);
-
-		if (end > len)
-			end = len;
-
-		fscale = 1.0;
-		rise = 0.0;
-
-		alist = pango_attr_iterator_get_attrs(iter);
-
-		while (alist) {
-			anext = alist->next;
-			alist->next = NULL;
+	pdf_op(pdf, "BT");
+	pdf_puts(pdf, "   ");
+	pdf_op2(pdf, x, y, "Td");
 
-			attr = alist->data;
+	for (i = 0; i < m->runs->len; i++) {
+		run = &g_array_index(m->runs, afm_run_t, i);
 
-			switch (attr->klass->type) {
-			case PANGO_ATTR_RISE:
-			{
-				PangoAttrInt *arise = (void *) attr;
-				rise = ((double) arise->value) / 10000.0;
-				break;
-			}
-			case PANGO_ATTR_SCALE:
-			{
-				PangoAttrFloat *ascale = (void *) attr;
-				fscale = ascale->value;
-				break;
-			}
-			default:
-				fprintf(stderr, "%s: unhandled attr %u\n",
-					__FUNCTION__, attr->klass->type);
-				break;
-			}
-
-			pango_attribute_destroy(attr);
-			g_slist_free(alist);
-
-			alist = anext;
-		}
-
-		offset += afm_output_string(file, afm, text, start, end,
-					    scale * fscale,
-					    scale * fscale * afm->font_ascent
-							   * rise / 1000.0);
-
-		if (end == len)
-			break;
-	} while (TRUE == pango_attr_iterator_next(iter));
-
-	pango_attr_iterator_destroy(iter);
+		afm_output_string(pdf, afm, m->text, run->start, run->end,
+					    scale * run->fscale,
+					    scale * run->fscale * afm->font_ascent
+							* run->rise / 1000.0);
+	}
 
-	offset += fprintf(file, "ET\n");
+	pdf_op(pdf, "ET");
 
 out:
-	pango_attr_list_unref(attr_list);
-	g_free(text);
-
-	return offset;
+	afm_markup_unref(m);
 }
@@ -7,6 +7,8 @@
 struct __char_s__;
 typedef struct __char_s__ char_t;
 
+struct __pdf_s__;
+
 typedef struct {
 	int	llx;
 	int	lly;
@@ -86,6 +88,13 @@ typedef struct {
 	kern_t		*kern_hash[KERN_HASH_SIZE];
 
 	char_table_t	char_table[256];
+
+	/* by char_table index */
+	short		kern_table[256][256];
+	unsigned char	ligature_table[256][256];	/* index, or 0 */
+
+	GStaticMutex	markup_lock;	/* covers markup_cache */
+	GHashTable	*markup_cache;
 } afm_t;
 
 typedef struct {
@@ -101,17 +110,56 @@ typedef struct {
 	} bbox;
 } afm_extents_t;
 
+/*
+ * Font metrics compiled in, as generated by afmgen.
+ */
+typedef struct {
+	const char	*name;
+	int		index;		/* in char_table, or -1 */
+	int		width;
+	bbox_t		bbox;
+} afm_char_data_t;
+
+typedef struct {
+	const char	*name[2];
+	const char	*ligature;
+} afm_ligature_data_t;
+
+typedef struct {
+	const char	*name[2];
+	int		value;
+} afm_kern_data_t;
+
+typedef struct {
+	const char	*font_name;
+	const char	*full_name;
+	const char	*family_name;
+	const char	*weight;
+
+	int		font_ascent;
+	int		font_descent;
+
+	const afm_char_data_t		*chars;
+	unsigned int			nr_chars;
+	const afm_ligature_data_t	*ligatures;
+	unsigned int			nr_ligatures;
+	const afm_kern_data_t		*kerns;
+	unsigned int			nr_kerns;
+} afm_font_data_t;
+
 int afm_read_file(const char *filename, afm_t **afmp);
+int afm_from_table(const afm_font_data_t *data, afm_t **afmp);
 void afm_free(afm_t *afm);
 
 char_t *afm_lookup_char_by_name(afm_t *afm, const char *name,
 				unsigned int name_len);
+int afm_encode_char(afm_t *afm, char_t *ch);
 
 int afm_text_extents(afm_t *afm, double scale,
 		     const char *markup, size_t len,
 		     afm_extents_t *extents);
 
-int afm_print_text(FILE *file, afm_t *afm, double scale, double x, double y,
-		     const char *markup, size_t len);
+void afm_print_text(struct __pdf_s__ *pdf, afm_t *afm, double scale,
+		    double x, double y, const char *markup, size_t len);
 
 #endif /* !(_AFM_H) */
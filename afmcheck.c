@@ -0,0 +1,98 @@
+/* $Id$
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <glib.h>
+
+#include "afm.h"
+
+/*
+ * Built by the Makefile against a table just written by afmgen, with
+ * AFM_TABLE_H naming the file and AFM_FONT the afm_font_data_t in it.
+ */
+#include AFM_TABLE_H
+
+static char *progname;
+
+/*
+ * Extents of every pair of encoded characters must match those from
+ * the AFM file the table was generated from.
+ */
+static int
+verify_table(const char *filename)
+{
+	afm_extents_t e1, e2;
+	unsigned char text[2];
+	unsigned int i, j, n = 0, bad = 0;
+	afm_t *afm, *ref;
+
+	if (afm_from_table(&AFM_FONT, &afm) < 0)
+		return 1;
+
+	if (afm_read_file(filename, &ref) < 0) {
+		afm_free(afm);
+		return 1;
+	}
+
+	for (i = 0; i < 256; i++) {
+		if (!afm->char_table[i].ch != !ref->char_table[i].ch) {
+			fprintf(stderr, "%s: code %u encoded differently\n",
+				progname, i);
+			bad++;
+		}
+	}
+
+	for (i = 32; i < 256; i++) {
+		for (j = 32; j < 256; j++) {
+			if (!afm->char_table[i].ch || !afm->char_table[j].ch)
+				continue;
+			if (i == '<' || i == '&' || j == '<' || j == '&')
+				continue;
+
+			text[0] = i;
+			text[1] = j;
+			afm_text_extents(afm, 1000.0, (char *) text, 2, &e1);
+			afm_text_extents(ref, 1000.0, (char *) text, 2, &e2);
+
+			n++;
+			if (memcmp(&e1, &e2, sizeof(afm_extents_t))) {
+				fprintf(stderr, "%s: pair %u %u differs\n",
+					progname, i, j);
+				bad++;
+			}
+		}
+	}
+
+	afm_free(ref);
+	afm_free(afm);
+
+	if (bad) {
+		fprintf(stderr, "%s: %s: %u differences in %u pairs\n",
+			progname, filename, bad, n);
+		return 1;
+	}
+
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	progname = strrchr(argv[0], '/');
+	if (progname)
+		progname++;
+	else
+		progname = argv[0];
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s <afm-file>\n", progname);
+		exit(1);
+	}
+
+	return verify_table(argv[1]);
+}
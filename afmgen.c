@@ -0,0 +1,156 @@
+/* $Id$
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <glib.h>
+
+#include "afm.h"
+
+static char *progname;
+
+static void
+print_string(const char *s)
+{
+	if (NULL == s) {
+		printf("NULL");
+		return;
+	}
+
+	putchar('"');
+	while (*s) {
+		if ((*s == '"') || (*s == '\\'))
+			putchar('\\');
+		putchar(*s++);
+	}
+	putchar('"');
+}
+
+static void
+print_char(afm_t *afm, char_t *ch)
+{
+	int index = -1;
+
+	if (afm->char_table[ch->index].ch == ch)
+		index = ch->index;
+
+	printf("\t{ ");
+	print_string(ch->name);
+	printf(", %d, %d, { %d, %d, %d, %d } },\n", index, ch->width,
+	       ch->bbox.llx, ch->bbox.lly, ch->bbox.urx, ch->bbox.ury);
+}
+
+static int
+generate_table(const char *filename, const char *name)
+{
+	unsigned int nr_chars = 0, nr_ligatures = 0, nr_kerns = 0;
+	ligature_t *lig;
+	kern_t *kern;
+	char_t *ch;
+	afm_t *afm;
+	int i;
+
+	if (afm_read_file(filename, &afm) < 0)
+		return 1;
+
+	printf("/* Generated by %s from %s, do not edit.\n */\n\n",
+	       progname, filename);
+
+	/*
+	 * Encoded characters first, by code, then those only reachable
+	 * by name.
+	 */
+	printf("static const afm_char_data_t afm_%s_chars[] =\n{\n", name);
+	for (i = 0; i < 256; i++) {
+		if (NULL == afm->char_table[i].ch)
+			continue;
+		print_char(afm, afm->char_table[i].ch);
+		nr_chars++;
+	}
+	for (i = 0; i < CHAR_HASH_SIZE; i++) {
+		for (ch = afm->char_hash[i]; ch; ch = ch->next_by_name) {
+			if (afm->char_table[ch->index].ch == ch)
+				continue;
+			print_char(afm, ch);
+			nr_chars++;
+		}
+	}
+	printf("};\n\n");
+
+	printf("static const afm_ligature_data_t afm_%s_ligatures[] =\n{\n",
+	       name);
+	for (i = 0; i < LIGATURE_HASH_SIZE; i++) {
+		for (lig = afm->ligature_hash[i]; lig;
+		     lig = lig->next_by_chars) {
+			printf("\t{ { ");
+			print_string(lig->name[0]);
+			printf(", ");
+			print_string(lig->name[1]);
+			printf(" }, ");
+			print_string(lig->ligature);
+			printf(" },\n");
+			nr_ligatures++;
+		}
+	}
+	printf("};\n\n");
+
+	printf("static const afm_kern_data_t afm_%s_kerns[] =\n{\n", name);
+	for (i = 0; i < KERN_HASH_SIZE; i++) {
+		for (kern = afm->kern_hash[i]; kern;
+		     kern = kern->next_by_chars) {
+			printf("\t{ { ");
+			print_string(kern->name[0]);
+			printf(", ");
+			print_string(kern->name[1]);
+			printf(" }, %d },\n", kern->value);
+			nr_kerns++;
+		}
+	}
+	printf("};\n\n");
+
+	printf("static const afm_font_data_t afm_%s =\n{\n", name);
+	printf("\t");
+	print_string(afm->font_name);
+	printf(",\n\t");
+	print_string(afm->full_name);
+	printf(",\n\t");
+	print_string(afm->family_name);
+	printf(",\n\t");
+	print_string(afm->weight);
+	printf(",\n");
+	printf("\t%d, %d,\n", afm->font_ascent, afm->font_descent);
+	printf("\tafm_%s_chars, %u,\n", name, nr_chars);
+	printf("\tafm_%s_ligatures, %u,\n", name, nr_ligatures);
+	printf("\tafm_%s_kerns, %u\n", name, nr_kerns);
+	printf("};\n");
+
+	afm_free(afm);
+
+	if (fflush(stdout) || ferror(stdout)) {
+		fprintf(stderr, "%s: write: %s\n", progname, strerror(errno));
+		return 1;
+	}
+
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	progname = strrchr(argv[0], '/');
+	if (progname)
+		progname++;
+	else
+		progname = argv[0];
+
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s <afm-file> <name>\n", progname);
+		exit(1);
+	}
+
+	return generate_table(argv[1], argv[2]);
+}
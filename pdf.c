@@ -0,0 +1,368 @@
+/* $Id$
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+
+#include <zlib.h>
+
+#include <glib.h>
+
+#include "pdf.h"
+
+
+#define PDF_MAX_DIGITS	8
+
+/*
+ * Level 1 is within 20% of the default level's size on plot streams,
+ * at a sixth of the time.
+ */
+#define PDF_DEFLATE_LEVEL	Z_BEST_SPEED
+
+static const double pdf_scale[PDF_MAX_DIGITS + 1] =
+{
+	1.0, 10.0, 100.0, 1000.0, 1e4, 1e5, 1e6, 1e7, 1e8
+};
+
+pdf_t *
+pdf_open(const char *filename)
+{
+	pdf_t *pdf;
+	guint32 offset = 0;
+	FILE *file;
+
+	file = fopen(filename, "wb");
+	if (NULL == file) {
+		fprintf(stderr, "%s:%u: open '%s': %s\n",
+			__FUNCTION__, __LINE__, filename, strerror(errno));
+		return NULL;
+	}
+
+	pdf = g_new0(pdf_t, 1);
+	pdf->file = file;
+	pdf->buf = g_string_sized_new(65536);
+	pdf->stream = g_string_sized_new(65536);
+	pdf->out = pdf->buf;
+
+	/* object 0 is the head of the free list */
+	pdf->xref = g_array_new(FALSE, FALSE, sizeof(guint32));
+	g_array_append_val(pdf->xref, offset);
+
+	pdf_puts(pdf, "%PDF-1.3\n");
+	return pdf;
+}
+
+int
+pdf_flush(pdf_t *pdf)
+{
+	GString *buf = pdf->buf;
+
+	if (fwrite(buf->str, 1, buf->len, pdf->file) != buf->len) {
+		fprintf(stderr, "%s:%u: write: %s\n",
+			__FUNCTION__, __LINE__, strerror(errno));
+		return -1;
+	}
+
+	pdf->flushed += buf->len;
+	g_string_truncate(buf, 0);
+	return 0;
+}
+
+int
+pdf_close(pdf_t *pdf)
+{
+	int ret;
+
+	ret = pdf_flush(pdf);
+
+	if (fclose(pdf->file)) {
+		fprintf(stderr, "%s:%u: close: %s\n",
+			__FUNCTION__, __LINE__, strerror(errno));
+		ret = -1;
+	}
+	pdf->file = NULL;
+
+	pdf_free(pdf);
+	return ret;
+}
+
+void
+pdf_free(pdf_t *pdf)
+{
+	if (pdf->file)
+		fclose(pdf->file);
+	g_string_free(pdf->buf, TRUE);
+	g_string_free(pdf->stream, TRUE);
+	g_array_free(pdf->xref, TRUE);
+	g_free(pdf);
+}
+
+unsigned int
+pdf_new_object(pdf_t *pdf)
+{
+	guint32 offset = 0;
+
+	g_array_append_val(pdf->xref, offset);
+	return pdf->xref->len - 1;
+}
+
+void
+pdf_begin_object(pdf_t *pdf, unsigned int obj)
+{
+	g_array_index(pdf->xref, guint32, obj) = pdf->flushed + pdf->buf->len;
+	g_string_append_printf(pdf->buf, "%u 0 obj\n", obj);
+}
+
+void
+pdf_end_object(pdf_t *pdf)
+{
+	g_string_append(pdf->buf, "endobj\n\n");
+}
+
+/*
+ * Content operators go to a separate buffer until pdf_end_stream(),
+ * which deflates it into object 'obj'.  'dict' holds further entries
+ * of the stream dictionary, or is NULL.
+ */
+void
+pdf_begin_stream(pdf_t *pdf)
+{
+	g_string_truncate(pdf->stream, 0);
+	pdf->out = pdf->stream;
+}
+
+int
+pdf_end_stream(pdf_t *pdf, unsigned int obj, const char *dict)
+{
+	GString *s = pdf->stream;
+	unsigned char *data;
+	z_stream z;
+	uLong size;
+	int ret = 0;
+
+	pdf->out = pdf->buf;
+
+	memset(&z, 0, sizeof(z));
+	if (Z_OK != deflateInit(&z, PDF_DEFLATE_LEVEL)) {
+		fprintf(stderr, "%s:%u: deflateInit: %s\n",
+			__FUNCTION__, __LINE__, z.msg ? z.msg : "failed");
+		return -1;
+	}
+
+	size = deflateBound(&z, s->len);
+	data = g_malloc(size);
+
+	z.next_in = (unsigned char *) s->str;
+	z.avail_in = s->len;
+	z.next_out = data;
+	z.avail_out = size;
+
+	if (Z_STREAM_END != deflate(&z, Z_FINISH)) {
+		fprintf(stderr, "%s:%u: deflate: %s\n",
+			__FUNCTION__, __LINE__, z.msg ? z.msg : "failed");
+		ret = -1;
+		goto out;
+	}
+
+	pdf_begin_object(pdf, obj);
+	pdf_printf(pdf, "   << /Length %lu\n", z.total_out);
+	pdf_puts(pdf, "      /Filter /FlateDecode\n");
+	if (dict)
+		pdf_puts(pdf, dict);
+	pdf_puts(pdf, "   >>\n");
+	pdf_puts(pdf, "stream\n");
+	g_string_append_len(pdf->buf, (char *) data, z.total_out);
+	pdf_puts(pdf, "\nendstream\n");
+	pdf_end_object(pdf);
+
+out:
+	deflateEnd(&z);
+	g_free(data);
+	g_string_truncate(s, 0);
+	return ret;
+}
+
+void
+pdf_puts(pdf_t *pdf, const char *s)
+{
+	g_string_append(pdf->out, s);
+}
+
+void
+pdf_putc(pdf_t *pdf, char c)
+{
+	g_string_append_c(pdf->out, c);
+}
+
+void
+pdf_printf(pdf_t *pdf, const char *format, ...)
+{
+	va_list ap;
+
+	va_start(ap, format);
+	g_string_append_vprintf(pdf->out, format, ap);
+	va_end(ap);
+}
+
+/*
+ * Fixed point with at most 'digits' decimals, trailing zeros dropped.
+ */
+void
+pdf_real(pdf_t *pdf, double v, int digits)
+{
+	char buf[32], *end = &buf[sizeof(buf)], *p = end;
+	guint64 n, ip, scale;
+	gboolean neg;
+	int i;
+
+	if (digits > PDF_MAX_DIGITS)
+		digits = PDF_MAX_DIGITS;
+
+	neg = (v < 0.0);
+	if (neg)
+		v = -v;
+
+	if (!(v * pdf_scale[digits] < 1e18)) {
+		g_string_append_printf(pdf->out, "%.*f", digits,
+				       neg ? -v : v);
+		return;
+	}
+
+	scale = (guint64) pdf_scale[digits];
+	n = (guint64) (v * pdf_scale[digits] + 0.5);
+	if (0 == n) {
+		g_string_append_c(pdf->out, '0');
+		return;
+	}
+
+	ip = n / scale;
+	n %= scale;
+
+	if (n) {
+		i = digits;
+		while (0 == n % 10) {
+			n /= 10;
+			i--;
+		}
+		while (i--) {
+			*--p = '0' + n % 10;
+			n /= 10;
+		}
+		*--p = '.';
+	}
+
+	do {
+		*--p = '0' + ip % 10;
+		ip /= 10;
+	} while (ip);
+
+	if (neg)
+		*--p = '-';
+
+	g_string_append_len(pdf->out, p, end - p);
+}
+
+void
+pdf_op(pdf_t *pdf, const char *op)
+{
+	g_string_append(pdf->out, op);
+	g_string_append_c(pdf->out, '\n');
+}
+
+void
+pdf_op1(pdf_t *pdf, double a, const char *op)
+{
+	pdf_real(pdf, a, PDF_DIGITS);
+	g_string_append_c(pdf->out, ' ');
+	pdf_op(pdf, op);
+}
+
+void
+pdf_op2(pdf_t *pdf, double a, double b, const char *op)
+{
+	pdf_real(pdf, a, PDF_DIGITS);
+	g_string_append_c(pdf->out, ' ');
+	pdf_real(pdf, b, PDF_DIGITS);
+	g_string_append_c(pdf->out, ' ');
+	pdf_op(pdf, op);
+}
+
+void
+pdf_op3(pdf_t *pdf, double a, double b, double c, const char *op)
+{
+	pdf_real(pdf, a, PDF_DIGITS);
+	g_string_append_c(pdf->out, ' ');
+	pdf_op2(pdf, b, c, op);
+}
+
+void
+pdf_curveto(pdf_t *pdf, double x1, double y1, double x2, double y2,
+	    double x3, double y3)
+{
+	pdf_real(pdf, x1, PDF_DIGITS);
+	g_string_append_c(pdf->out, ' ');
+	pdf_real(pdf, y1, PDF_DIGITS);
+	g_string_append_c(pdf->out, ' ');
+	pdf_real(pdf, x2, PDF_DIGITS);
+	g_string_append_c(pdf->out, ' ');
+	pdf_real(pdf, y2, PDF_DIGITS);
+	g_string_append_c(pdf->out, ' ');
+	pdf_op2(pdf, x3, y3, "c");
+}
+
+/*
+ * The matrix part gets more digits, it may hold unit conversions.
+ */
+void
+pdf_concat(pdf_t *pdf, double a, double b, double c, double d,
+	   double e, double f)
+{
+	double m[4] = { a, b, c, d };
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		pdf_real(pdf, m[i], PDF_MAX_DIGITS);
+		g_string_append_c(pdf->out, ' ');
+	}
+	pdf_op2(pdf, e, f, "cm");
+}
+
+void
+pdf_translate(pdf_t *pdf, double x, double y)
+{
+	g_string_append(pdf->out, "1 0 0 1 ");
+	pdf_op2(pdf, x, y, "cm");
+}
+
+void
+pdf_finish(pdf_t *pdf, unsigned int root, unsigned int info)
+{
+	guint32 xref = pdf->flushed + pdf->buf->len;
+	unsigned int i;
+
+	pdf->out = pdf->buf;
+
+	pdf_puts(pdf, "xref\n");
+	pdf_printf(pdf, "0 %u\n", pdf->xref->len);
+	pdf_printf(pdf, "%010u %05u f \n", 0, 65535);
+	for (i = 1; i < pdf->xref->len; i++)
+		pdf_printf(pdf, "%010u %05u n \n",
+			   g_array_index(pdf->xref, guint32, i), 0);
+	pdf_puts(pdf, "\n");
+
+	pdf_puts(pdf, "trailer\n");
+	pdf_printf(pdf, "   << /Size %u\n", pdf->xref->len);
+	pdf_printf(pdf, "      /Root %u 0 R\n", root);
+	if (info)
+		pdf_printf(pdf, "      /Info %u 0 R\n", info);
+	pdf_puts(pdf, "   >>\n");
+	pdf_puts(pdf, "\n");
+
+	pdf_puts(pdf, "startxref\n");
+	pdf_printf(pdf, "%u\n", xref);
+	pdf_puts(pdf, "%%EOF\n");
+}
@@ -0,0 +1,56 @@
+/* $Id$
+ */
+
+#ifndef _PDF_H
+#define _PDF_H 1
+
+/*
+ * PDF file built in memory and written out by pdf_flush() between
+ * objects.  Objects are numbered by pdf_new_object() and their offsets
+ * recorded as they are begun, so the xref table and stream lengths
+ * need no bookkeeping by the caller.
+ */
+
+#define PDF_DIGITS	3	/* decimals of coordinates and widths */
+
+struct __pdf_s__ {
+	GString		*buf;		/* file contents */
+	GString		*out;		/* buf, or stream while one is open */
+	GString		*stream;
+	GArray		*xref;		/* guint32 offset by object number */
+
+	FILE		*file;
+	guint32		flushed;	/* bytes of buf already in file */
+};
+typedef struct __pdf_s__ pdf_t;
+
+pdf_t *pdf_open(const char *filename);
+int pdf_flush(pdf_t *pdf);
+int pdf_close(pdf_t *pdf);
+void pdf_free(pdf_t *pdf);
+
+unsigned int pdf_new_object(pdf_t *pdf);
+void pdf_begin_object(pdf_t *pdf, unsigned int obj);
+void pdf_end_object(pdf_t *pdf);
+
+void pdf_begin_stream(pdf_t *pdf);
+int pdf_end_stream(pdf_t *pdf, unsigned int obj, const char *dict);
+
+void pdf_puts(pdf_t *pdf, const char *s);
+void pdf_putc(pdf_t *pdf, char c);
+void pdf_printf(pdf_t *pdf, const char *format, ...) G_GNUC_PRINTF(2, 3);
+void pdf_real(pdf_t *pdf, double v, int digits);
+
+void pdf_op(pdf_t *pdf, const char *op);
+void pdf_op1(pdf_t *pdf, double a, const char *op);
+void pdf_op2(pdf_t *pdf, double a, double b, const char *op);
+void pdf_op3(pdf_t *pdf, double a, double b, double c, const char *op);
+void pdf_curveto(pdf_t *pdf, double x1, double y1, double x2, double y2,
+		 double x3, double y3);
+void pdf_concat(pdf_t *pdf, double a, double b, double c, double d,
+		double e, double f);
+void pdf_translate(pdf_t *pdf, double x, double y);
+
+void pdf_finish(pdf_t *pdf, unsigned int root, unsigned int info);
+
+#endif /* !(_PDF_H) */
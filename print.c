@@ -16,10 +16,24 @@
 #include <glib/gi18n.h>
 
 #include "radar.h"
+#include "raster.h"
 #include "afm.h"
+#include "pdf.h"
+
+#include "afm_Helvetica.h"
 
 
 #undef DEBUG_LABEL_ALIGN
+#undef DEBUG_PDF_TIME
+
+
+#define IMAGE_MAX_SIZE		16384	/* whole image in memory */
+#define PNG_MAX_SIZE		32768	/* streamed in strips */
+
+#define PDF_ARC_TOLERANCE	0.05	/* mm, below the thinnest line */
+#define PDF_ARC_MAX_SEGMENTS	64
+
+#define PDF_FONT_NAME		"Helvetica"
 
 
 typedef struct {
@@ -293,6 +307,55 @@ static const table_descriptor_t data_table[] =
 };
 #define NR_DATA_TABLE_ROWS	(sizeof(data_table) / sizeof(data_table[0]))
 
+/*
+ * Translations used on every page, looked up once on the GTK thread
+ * while the codeset is bound to ISO-8859-1.
+ */
+typedef struct {
+	char		*row[NR_DATA_TABLE_ROWS];
+	char		*unit[NR_DATA_TABLE_ROWS];	/* "[unit]" */
+	char		*scale[2];	/* nautical miles, minutes */
+	char		*unregistered;
+} pdf_strings_t;
+
+/*
+ * A display item with its style resolved to RGB.  Vectors have two
+ * points, arcs and labels their center in points[0].
+ */
+typedef struct {
+	int		type;		/* enum display_item_type */
+	int		is_target;
+	guint32		rgb;
+	int		line_width;
+	int		line_style;
+	point_t		points[3];
+	int		npoints;
+	double		radius;
+	double		angle1, angle2;
+	double		xoff, yoff;
+	double		xalign, yalign;
+	char		*markup;
+} pdf_item_t;
+
+/*
+ * Everything a page takes from the radar, copied on the GTK thread.
+ * Pages are written from the snapshot alone, so any thread may do it.
+ */
+typedef struct {
+	int		licensed;
+	double		range;
+	int		marks;		/* of radar_ranges[rindex] */
+	int		digits;
+	double		cx, cy;
+	int		r;
+
+	GArray		*items;		/* pdf_item_t */
+
+	unsigned int	table_columns;
+	char		*cells[NR_DATA_TABLE_ROWS][TABLE_MAX_COLUMNS];
+	char		*range_text;
+} pdf_snapshot_t;
+
 static char_t *pdf_char_bullet;
 
 
@@ -325,22 +388,21 @@ radar_save_as_image(radar_t *radar, int width, int height,
 	PangoAttrList *attrs;
 	PangoLayout *layout;
 	char label_font[32];
-	GdkPixbuf *pixbuf;
+	GdkWindow *window;
+	GdkPixbuf *pixbuf = NULL;
+	raster_t *raster;
+	display_xform_t xf;
 	GError *gerror;
-	target_t *s;
-	vector_t *v, tvec;
-	arc_t *a, tarc;
-	poly_t *p, tpoly;
-	text_label_t *l, tlabel;
 	char text[16];
 	double cx, cy;
 	int step, radius;
 	int tw, th;
 	int base, size;
 	int error = 0;
-	int i, j, k;
 
 
+	radar_flush_redraw(radar);
+
 	if (width < height)
 		base = width;
 	else
@@ -354,7 +416,7 @@ radar_save_as_image(radar_t *radar, int width, int height,
 
 	sprintf(label_font, "%s %u", LABEL_BASE, size);
 
-	context = gtk_widget_get_pango_context(radar->canvas);
+	context = raster_create_pango_context();
 	layout = pango_layout_new(context);
 	font_description = pango_font_description_from_string(label_font);
 
@@ -381,128 +443,54 @@ radar_save_as_image(radar_t *radar, int width, int height,
 		radius = ((height / 2 - tw) / 12) * 12;
 	step = radius / 6;
 
-	pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, TRUE, 8, width, height);
-	if (NULL == pixbuf) {
-		fprintf(stderr, "%s: gdk_pixbuf_new: out of memory\n",
-			__FUNCTION__);
-		return -ENOMEM;
+	raster = raster_new(width, height);
+
+	window = radar->window->window;
+	if (window) {
+		gdk_window_set_cursor(window, radar->busy_cursor);
+		gdk_display_sync(gdk_drawable_get_display(window));
 	}
 
-	gdk_window_set_cursor(radar->window->window, radar->busy_cursor);
-	gdk_display_sync(gdk_drawable_get_display(radar->window->window));
+	/*
+	 * Record everything, then rasterize in tiles.  Nothing is drawn
+	 * to (or read back from) the X server: labels are rendered with
+	 * cairo on the export font map.
+	 */
+	radar->raster = raster;
 
-	radar_draw_bg_pixmap(radar, radar->canvas->window, pixbuf, 0xff,
+	radar_draw_bg_pixmap(radar, NULL, NULL, 0xff,
 			     layout, TRUE, cx, cy, step, radius, width, height);
 
-	for (i = 0; i < RADAR_NR_VECTORS; i++) {
-		v = &radar->vectors[i];
+	xf.cx = cx;
+	xf.cy = cy;
+	xf.r = radius;
+	xf.context = context;
+	xf.font = font_description;
 
-		if (!v->is_visible)
-			continue;
+	radar_draw_display_list(radar, NULL, NULL, 0xff, TRUE, &xf);
 
-		tvec.gc = v->gc;
-		translate_point(v->x1, v->y1, radar->cx, radar->cy, radar->r,
-				cx, cy, radius, &tvec.x1, &tvec.y1);
-		translate_point(v->x2, v->y2, radar->cx, radar->cy, radar->r,
-				cx, cy, radius, &tvec.x2, &tvec.y2);
+	radar->raster = NULL;
 
-		radar_draw_vector(radar, radar->canvas->window,
-				  pixbuf, 0xff, TRUE, &tvec);
+	/*
+	 * PNG is encoded strip by strip, without the full size image.
+	 */
+	if (!strcmp(type, "png") && NULL == keys[0]) {
+		error = raster_save_png(raster, filename,
+					radar->export_threads);
+		goto out;
 	}
 
-	for (i = 0; i < RADAR_NR_TARGETS; i++) {
-		s = &radar->target[i];
-
-		for (j = 0; j < TARGET_NR_VECTORS; j++) {
-			v = &s->vectors[j];
-
-			if (!v->is_visible)
-				continue;
-
-			tvec.gc = v->gc;
-			translate_point(v->x1, v->y1,
-					radar->cx, radar->cy, radar->r,
-					cx, cy, radius, &tvec.x1, &tvec.y1);
-			translate_point(v->x2, v->y2,
-					radar->cx, radar->cy, radar->r,
-					cx, cy, radius, &tvec.x2, &tvec.y2);
-
-			radar_draw_vector(radar, radar->canvas->window,
-					  pixbuf, 0xff, TRUE, &tvec);
-		}
-
-		for (j = 0; j < TARGET_NR_ARCS; j++) {
-			a = &s->arcs[j];
-
-			if (!a->is_visible)
-				continue;
-
-			tarc.gc = a->gc;
-			tarc.angle1 = a->angle1;
-			tarc.angle2 = a->angle2;
-			translate_point(a->x, a->y,
-					radar->cx, radar->cy, radar->r,
-					cx, cy, radius, &tarc.x, &tarc.y);
-			translate_length(a->radius, radar->r,
-					 radius, &tarc.radius);
-
-			radar_draw_arc(radar, radar->canvas->window,
-				       pixbuf, 0xff, TRUE, &tarc);
-		}
-
-		for (j = 0; j < TARGET_NR_POLYS; j++) {
-			p = &s->polys[j];
-
-			if (!p->is_visible)
-				continue;
-
-			tpoly.gc = p->gc;
-			tpoly.npoints = p->npoints;
-			for (k = 0; k < tpoly.npoints; k++) {
-				translate_point(p->points[k].x, p->points[k].y,
-						radar->cx, radar->cy, radar->r,
-						cx, cy, radius,
-						&tpoly.points[k].x,
-						&tpoly.points[k].y);
-			}
-
-			radar_draw_poly(radar, radar->canvas->window,
-					pixbuf, 0xff, TRUE, &tpoly);
-		}
-
-		for (j = 0; j < TARGET_NR_LABELS; j++) {
-			l = &s->labels[j];
-
-			if (!l->is_visible)
-				continue;
-
-			tlabel.fg = l->fg;
-			tlabel.bg = l->bg;
-			tlabel.xalign = l->xalign;
-			tlabel.yalign = l->yalign;
-
-			tlabel.layout = pango_layout_copy(l->layout);
-			pango_layout_set_font_description(tlabel.layout,
-							  font_description);
-			pango_layout_get_pixel_size(tlabel.layout,
-						    (int *) &tlabel.tw,
-						    (int *) &tlabel.th);
-
-			translate_point(l->cx, l->cy,
-					radar->cx, radar->cy, radar->r,
-					cx, cy, radius, &tlabel.cx, &tlabel.cy);
-			translate_length(l->xoff, radar->r, radius,
-					 &tlabel.xoff);
-			translate_length(l->yoff, radar->r, radius,
-					 &tlabel.yoff);
-
-			radar_draw_label(radar, radar->canvas->window,
-					 pixbuf, 0xff, TRUE, &tlabel);
-
-			g_object_unref(tlabel.layout);
-		}
+	pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, TRUE, 8, width, height);
+	if (NULL == pixbuf) {
+		fprintf(stderr, "%s: gdk_pixbuf_new: out of memory\n",
+			__FUNCTION__);
+		error = -ENOMEM;
+		goto out;
 	}
 
+	error = raster_render(raster, pixbuf, radar->export_threads);
+	if (error < 0)
+		goto out;
 
 	gerror = NULL;
 	if (!gdk_pixbuf_savev(pixbuf, filename, type, keys, values, &gerror)) {
@@ -513,10 +501,14 @@ radar_save_as_image(radar_t *radar, int width, int height,
 	}
 
 out:
-	gdk_window_set_cursor(radar->window->window, NULL);
+	if (window)
+		gdk_window_set_cursor(window, NULL);
 
-	g_object_unref(pixbuf);
+	if (pixbuf)
+		g_object_unref(pixbuf);
+	raster_free(raster);
 	g_object_unref(layout);
+	g_object_unref(context);
 	pango_font_description_free(font_description);
 	pango_attr_list_unref(attrs);
 	return error;
@@ -528,108 +520,115 @@ out:
  * Plot Background and Vectors as PDF,
  * Plot Calculated Values as PDF.
  */
-static int
-output_gc_rgb_color(FILE *file, GdkGC *gc)
+static void
+output_rgb_color(pdf_t *pdf, guint32 rgb)
 {
-	GdkGCValues values;
-	GdkColormap *cmap;
-	GdkColor color;
 	double r, g, b;
 
-	gdk_gc_get_values(gc, &values);
-	color.pixel = values.foreground.pixel;
+	r = (double) ((rgb >> 16) & 0xff) / 255.0;
+	g = (double) ((rgb >> 8) & 0xff) / 255.0;
+	b = (double) (rgb & 0xff) / 255.0;
 
-	cmap = gdk_gc_get_colormap(gc);
-	if (cmap)
-		gdk_colormap_query_color(cmap, color.pixel, &color);
-	else
-		g_warning("No colormap in output_gc_rgb_color");
-
-	r = (double) (color.red >> 8) / 255.0;
-	g = (double) (color.green >> 8) / 255.0;
-	b = (double) (color.blue >> 8) / 255.0;
-
-	return fprintf(file, "%.4f %.4f %.4f rg\n%.4f %.4f %.4f RG\n",
-		       r, g, b, r, g, b);
+	pdf_op3(pdf, r, g, b, "rg");
+	pdf_op3(pdf, r, g, b, "RG");
 }
 
-static int
-output_arc(FILE *file, double cx, double cy, double radius,
-	   double angle1, double angle2)
+/*
+ * Arc path from angle1 over angle2 degrees as cubic Bezier segments of
+ * at most 90 degrees.  A segment of angle t is off the circle by at
+ * most r * 2/27 * sin^6(t/4) / cos^2(t/4), segments are halved until
+ * that is below PDF_ARC_TOLERANCE.
+ */
+static void
+output_arc_path(pdf_t *pdf, double cx, double cy, double radius,
+		double angle1, double angle2)
 {
-	int offset = 0;
-	double start, delta, sign, angle, inc;
-	double x, y;
+	double start, delta, t, k, s, c;
+	double x0, y0, x1, y1;
+	int i, n;
 
 	start = M_PI * angle1 / 180.0;
 	delta = M_PI * angle2 / 180.0;
-	if (delta < 0) {
-		sign = -1.0;
-		delta = -delta;
-	} else {
-		sign = 1.0;
+
+	n = ceil(fabs(delta) / M_PI_2);
+	if (n < 1)
+		n = 1;
+
+	while (n < PDF_ARC_MAX_SEGMENTS) {
+		s = sin(fabs(delta) / (4.0 * n));
+		c = cos(fabs(delta) / (4.0 * n));
+		if (fabs(radius) * 2.0 / 27.0 * pow(s, 6) / (c * c) <=
+		    PDF_ARC_TOLERANCE)
+			break;
+		n *= 2;
 	}
 
-	inc = M_PI / 180.0;
+	t = delta / n;
+	k = 4.0 / 3.0 * tan(t / 4.0);
 
-	x = cx + radius * cos(start);
-	y = cy + radius * sin(start);
+	x0 = cos(start);
+	y0 = sin(start);
 
-	offset += fprintf(file, "%.3f %.3f m\n", x, y);
-	
-	for (angle = inc; angle < delta; angle += inc) {
-		x = cx + radius * cos(start + sign * angle);
-		y = cy + radius * sin(start + sign * angle);
+	pdf_op2(pdf, cx + radius * x0, cy + radius * y0, "m");
 
-		offset += fprintf(file, "%.3f %.3f l\n", x, y);
-	}
+	for (i = 1; i <= n; i++) {
+		x1 = cos(start + t * i);
+		y1 = sin(start + t * i);
 
-	x = cx + radius * cos(start + sign * delta);
-	y = cy + radius * sin(start + sign * delta);
+		pdf_curveto(pdf, cx + radius * (x0 - k * y0),
+				 cy + radius * (y0 + k * x0),
+				 cx + radius * (x1 + k * y1),
+				 cy + radius * (y1 - k * x1),
+				 cx + radius * x1,
+				 cy + radius * y1);
 
-	offset += fprintf(file, "%.3f %.3f l\n", x, y);
+		x0 = x1;
+		y0 = y1;
+	}
+}
 
-	offset += fprintf(file, "S\n");
-	return offset;
+static void
+output_arc(pdf_t *pdf, double cx, double cy, double radius,
+	   double angle1, double angle2)
+{
+	output_arc_path(pdf, cx, cy, radius, angle1, angle2);
+	pdf_op(pdf, "S");
 }
 
-static int
-output_linear_scale(FILE *file, afm_t *afm, double fs, double lw,
-		    double width, double tick, double start, double end)
+static void
+output_linear_scale(pdf_t *pdf, afm_t *afm, const char *caption, double fs,
+		    double lw, double width, double tick, double start,
+		    double end)
 {
 	unsigned char text[32];
 	afm_extents_t extents;
 	double factor, x, y, cursor, c2, step;
-	int offset = 0;
 	int i;
 
 	factor = width / (end - start);
 	step = 1.0;	/* FIXME */
 
-	offset += fprintf(file, "0 g\n");
-	offset += fprintf(file, "0 G\n");
-	offset += fprintf(file, "%.3f w\n", lw);
+	pdf_op(pdf, "0 g");
+	pdf_op(pdf, "0 G");
+	pdf_op1(pdf, lw, "w");
 
 	x = 0.0;
 	y = 0.0;
 
-	offset += fprintf(file, "%.3f %.3f m\n", x, y);
+	pdf_op2(pdf, x, y, "m");
 
 	x = factor * (end - start);
 	y = 0.0;
 
-	offset += fprintf(file, "%.3f %.3f l\n", x, y);
-	offset += fprintf(file, "S\n");
+	pdf_op2(pdf, x, y, "l");
+	pdf_op(pdf, "S");
 
-	offset += fprintf(file, "%.3f w\n", lw / 2.0);
+	pdf_op1(pdf, lw / 2.0, "w");
 
-	sprintf((char *) text, _("Nautical Miles"));
-	afm_text_extents(afm, 1.5 * fs, (char *) text,
-			 strlen((char *) text), &extents);
+	afm_text_extents(afm, 1.5 * fs, caption, strlen(caption), &extents);
 	x = -extents.bbox.llx;
 	y = -extents.ascent - tick / 4.0;
-	offset += afm_print_text(file, afm, 1.5 * fs, x, y,
-				 (char *) text, strlen((char *) text));
+	afm_print_text(pdf, afm, 1.5 * fs, x, y, caption, strlen(caption));
 
 
 	cursor = start;
@@ -637,10 +636,10 @@ output_linear_scale(FILE *file, afm_t *afm, double fs, double lw,
 		x = factor * (cursor - start);
 		y = 0.0;
 
-		offset += fprintf(file, "%.3f %.3f m\n", x, y);
+		pdf_op2(pdf, x, y, "m");
 		y = tick;
-		offset += fprintf(file, "%.3f %.3f l\n", x, y);
-		offset += fprintf(file, "S\n");
+		pdf_op2(pdf, x, y, "l");
+		pdf_op(pdf, "S");
 
 
 		if (cursor < 10)
@@ -655,21 +654,21 @@ output_linear_scale(FILE *file, afm_t *afm, double fs, double lw,
 		x -= extents.width / 2.0;
 		y = tick + tick / 4.0;
 
-		offset += afm_print_text(file, afm, fs, x, y,
-					 (char *) text, strlen((char *) text));
+		afm_print_text(pdf, afm, fs, x, y,
+			       (char *) text, strlen((char *) text));
 
 		for (i = 1; i < 10; i++) {
 			c2 = cursor + (double)i * step / 10.0;
 			x = factor * (c2 - start);
 			y = 0.0;
 
-			offset += fprintf(file, "%.3f %.3f m\n", x, y);
+			pdf_op2(pdf, x, y, "m");
 			if (i == 5)
 				y += 2.0 * tick / 3.0;
 			else
 				y += tick / 2.0;
-			offset += fprintf(file, "%.3f %.3f l\n", x, y);
-			offset += fprintf(file, "S\n");
+			pdf_op2(pdf, x, y, "l");
+			pdf_op(pdf, "S");
 		}
 
 		cursor += step;
@@ -680,10 +679,10 @@ output_linear_scale(FILE *file, afm_t *afm, double fs, double lw,
 	x = factor * (cursor - start);
 	y = 0.0;
 
-	offset += fprintf(file, "%.3f %.3f m\n", x, y);
+	pdf_op2(pdf, x, y, "m");
 	y = tick;
-	offset += fprintf(file, "%.3f %.3f l\n", x, y);
-	offset += fprintf(file, "S\n");
+	pdf_op2(pdf, x, y, "l");
+	pdf_op(pdf, "S");
 
 	if (cursor < 10)
 		sprintf((char *) text, "%.1f", cursor);
@@ -696,83 +695,69 @@ output_linear_scale(FILE *file, afm_t *afm, double fs, double lw,
 	x -= extents.width / 2.0;
 	y = tick + tick / 4.0;
 
-	offset += afm_print_text(file, afm, fs, x, y,
-				 (char *) text, strlen((char *) text));
-
-	return offset;
+	afm_print_text(pdf, afm, fs, x, y,
+		       (char *) text, strlen((char *) text));
 }
 
-static int
-output_log_scale(FILE *file, afm_t *afm, double fs, double lw,
-		 double width, double tick, double start, double end)
+static void
+output_log_scale(pdf_t *pdf, afm_t *afm, const char *caption[2], double fs,
+		 double lw, double width, double tick, double start,
+		 double end)
 {
 	unsigned char text[32];
 	afm_extents_t extents;
 	double factor, x, y, cursor, c2, step;
-	int offset = 0;
 	int i;
 
 	factor = width / (log(end) - log(start));
 
-	offset += fprintf(file, "0 g\n");
-	offset += fprintf(file, "0 G\n");
-	offset += fprintf(file, "%.3f w\n", lw);
+	pdf_op(pdf, "0 g");
+	pdf_op(pdf, "0 G");
+	pdf_op1(pdf, lw, "w");
 
 	x = 0.0;
 	y = 0.0;
 
-	offset += fprintf(file, "%.3f %.3f m\n", x, y);
+	pdf_op2(pdf, x, y, "m");
 
 	x = factor * (log(end) - log(start));
 	y = 0.0;
 
-	offset += fprintf(file, "%.3f %.3f l\n", x, y);
-	offset += fprintf(file, "S\n");
+	pdf_op2(pdf, x, y, "l");
+	pdf_op(pdf, "S");
 
-	offset += fprintf(file, "%.3f w\n", lw / 2.0);
+	pdf_op1(pdf, lw / 2.0, "w");
 
-	sprintf((char *) text, _("Nautical Miles"));
-	afm_text_extents(afm, 1.5 * fs, (char *) text,
-			 strlen((char *) text), &extents);
+	afm_text_extents(afm, 1.5 * fs, caption[0], strlen(caption[0]), &extents);
 	x = -extents.bbox.llx;
 	y = -extents.ascent - tick / 4.0;
-	offset += afm_print_text(file, afm, 1.5 * fs, x, y,
-				 (char *) text, strlen((char *) text));
+	afm_print_text(pdf, afm, 1.5 * fs, x, y, caption[0], strlen(caption[0]));
 
 	x = extents.width + extents.ascent / 2.0;
 	y += extents.ascent / 2.0;
 
-	offset += fprintf(file, "%.3f %.3f m\n",
-			  x + extents.ascent / 4.0,
-			  y + extents.ascent / 4.0);
-	offset += fprintf(file, "%.3f %.3f l\n", x, y);
-	offset += fprintf(file, "%.3f %.3f l\n",
-			  x + extents.ascent / 4.0,
-			  y - extents.ascent / 4.0);
-	offset += fprintf(file, "h f\n");
+	pdf_op2(pdf, x + extents.ascent / 4.0, y + extents.ascent / 4.0, "m");
+	pdf_op2(pdf, x, y, "l");
+	pdf_op2(pdf, x + extents.ascent / 4.0, y - extents.ascent / 4.0, "l");
+	pdf_op(pdf, "h f");
 
 	x += extents.ascent / 4.0;
-	offset += fprintf(file, "%.3f %.3f m\n", x, y);
+	pdf_op2(pdf, x, y, "m");
 	x += extents.ascent;
-	offset += fprintf(file, "%.3f %.3f l\n", x, y);
-	offset += fprintf(file, "S\n");
+	pdf_op2(pdf, x, y, "l");
+	pdf_op(pdf, "S");
 
 	x += extents.ascent / 4.0;
-	offset += fprintf(file, "%.3f %.3f m\n",
-			  x - extents.ascent / 4.0,
-			  y + extents.ascent / 4.0);
-	offset += fprintf(file, "%.3f %.3f l\n", x, y);
-	offset += fprintf(file, "%.3f %.3f l\n",
-			  x - extents.ascent / 4.0,
-			  y - extents.ascent / 4.0);
-	offset += fprintf(file, "h f\n");
+	pdf_op2(pdf, x - extents.ascent / 4.0, y + extents.ascent / 4.0, "m");
+	pdf_op2(pdf, x, y, "l");
+	pdf_op2(pdf, x - extents.ascent / 4.0, y - extents.ascent / 4.0, "l");
+	pdf_op(pdf, "h f");
 
 	x += extents.ascent / 2.0;
 	y = -extents.ascent - tick / 4.0;
 
-	sprintf((char *) text, _("Minutes"));
-	offset += afm_print_text(file, afm, 1.5 * fs, x, y,
-				 (char *) text, strlen((char *) text));
+	afm_print_text(pdf, afm, 1.5 * fs, x, y,
+		       caption[1], strlen(caption[1]));
 
 
 	cursor = start;
@@ -782,10 +767,10 @@ output_log_scale(FILE *file, afm_t *afm, double fs, double lw,
 		x = factor * (log(cursor) - log(start));
 		y = 0.0;
 
-		offset += fprintf(file, "%.3f %.3f m\n", x, y);
+		pdf_op2(pdf, x, y, "m");
 		y = tick;
-		offset += fprintf(file, "%.3f %.3f l\n", x, y);
-		offset += fprintf(file, "S\n");
+		pdf_op2(pdf, x, y, "l");
+		pdf_op(pdf, "S");
 
 
 		if (cursor < 10)
@@ -799,8 +784,8 @@ output_log_scale(FILE *file, afm_t *afm, double fs, double lw,
 		x -= extents.width / 2.0;
 		y = tick + tick / 4.0;
 
-		offset += afm_print_text(file, afm, fs, x, y,
-					 (char *) text, strlen((char *) text));
+		afm_print_text(pdf, afm, fs, x, y,
+			       (char *) text, strlen((char *) text));
 
 		if (factor * (log(cursor + step) - log(cursor)) < 6.0) {
 			for (i = 1; i < 5; i++) {
@@ -808,10 +793,10 @@ output_log_scale(FILE *file, afm_t *afm, double fs, double lw,
 				x = factor * (log(c2) - log(start));
 				y = 0.0;
 
-				offset += fprintf(file, "%.3f %.3f m\n", x, y);
+				pdf_op2(pdf, x, y, "m");
 				y += tick / 2.0;
-				offset += fprintf(file, "%.3f %.3f l\n", x, y);
-				offset += fprintf(file, "S\n");
+				pdf_op2(pdf, x, y, "l");
+				pdf_op(pdf, "S");
 			}
 		} else {
 			for (i = 1; i < 10; i++) {
@@ -819,13 +804,13 @@ output_log_scale(FILE *file, afm_t *afm, double fs, double lw,
 				x = factor * (log(c2) - log(start));
 				y = 0.0;
 
-				offset += fprintf(file, "%.3f %.3f m\n", x, y);
+				pdf_op2(pdf, x, y, "m");
 				if (i == 5)
 					y += 2.0 * tick / 3.0;
 				else
 					y += tick / 2.0;
-				offset += fprintf(file, "%.3f %.3f l\n", x, y);
-				offset += fprintf(file, "S\n");
+				pdf_op2(pdf, x, y, "l");
+				pdf_op(pdf, "S");
 			}
 		}
 
@@ -837,10 +822,10 @@ output_log_scale(FILE *file, afm_t *afm, double fs, double lw,
 	x = factor * (log(cursor) - log(start));
 	y = 0.0;
 
-	offset += fprintf(file, "%.3f %.3f m\n", x, y);
+	pdf_op2(pdf, x, y, "m");
 	y = tick;
-	offset += fprintf(file, "%.3f %.3f l\n", x, y);
-	offset += fprintf(file, "S\n");
+	pdf_op2(pdf, x, y, "l");
+	pdf_op(pdf, "S");
 
 	if (cursor < 10)
 		sprintf((char *) text, "%.1f", cursor);
@@ -853,10 +838,8 @@ output_log_scale(FILE *file, afm_t *afm, double fs, double lw,
 	x -= extents.width / 2.0;
 	y = tick + tick / 4.0;
 
-	offset += afm_print_text(file, afm, fs, x, y,
-				 (char *) text, strlen((char *) text));
-
-	return offset;
+	afm_print_text(pdf, afm, fs, x, y,
+		       (char *) text, strlen((char *) text));
 }
 
 static int
@@ -1986,28 +1969,138 @@ first_non_digit(unsigned char *text)
 	return text;
 }
 
-static int
-output_table(radar_t *radar, FILE *file, afm_t *afm, double fs, double lw,
-	     double width, double height, pdf_rect_t *annot_rect)
+static pdf_strings_t *
+pdf_strings_new(void)
 {
 	const table_descriptor_t *dp;
-	unsigned char text[64], unit[32], *p;
-	const char *row_text;
-	afm_extents_t extents;
-	double rh, x, y, w;
-	double c1w, c2w, asc, desc, th;
-	double predec[TABLE_MAX_COLUMNS];
-	double postdec[TABLE_MAX_COLUMNS];
-	double prewidth, aoffset;
-	unsigned int sep, drow, row, col;
-	unsigned int table_columns;
+	pdf_strings_t *strings;
+	unsigned int row;
+
+	strings = g_new0(pdf_strings_t, 1);
+
+	for (row = 0; row < NR_DATA_TABLE_ROWS; row++) {
+		dp = &data_table[row];
+
+		if (dp->row)
+			strings->row[row] = g_strdup((dp->row[0] == '\0') ?
+						     "" : _(dp->row));
+		if (dp->unit)
+			strings->unit[row] = g_strdup_printf("[%s]",
+				(dp->unit[0] == '\0') ? "" : _(dp->unit));
+	}
+
+	strings->scale[0] = g_strdup(_("Nautical Miles"));
+	strings->scale[1] = g_strdup(_("Minutes"));
+	strings->unregistered =
+		g_strdup_printf(_("Radarplot %u.%u.%u (unregistered)"),
+				RADAR_MAJOR, RADAR_MINOR, RADAR_PATCHLEVEL);
+
+	return strings;
+}
+
+static void
+pdf_strings_free(pdf_strings_t *strings)
+{
+	unsigned int row;
+
+	for (row = 0; row < NR_DATA_TABLE_ROWS; row++) {
+		g_free(strings->row[row]);
+		g_free(strings->unit[row]);
+	}
+	g_free(strings->scale[0]);
+	g_free(strings->scale[1]);
+	g_free(strings->unregistered);
+	g_free(strings);
+}
+
+/*
+ * Table cells use pdf_char_bullet, the font must have been looked up.
+ */
+static pdf_snapshot_t *
+pdf_snapshot_new(radar_t *radar)
+{
+	const table_descriptor_t *dp;
+	unsigned char text[64];
+	display_style_t *style;
+	display_item_t *item;
+	pdf_snapshot_t *snap;
+	pdf_item_t *pi;
+	vector_t *vect;
+	arc_t *arc;
+	poly_t *poly;
+	text_label_t *label;
 	target_t *target;
-	int offset = 0;
-	int len, prelen;
-	int i;
+	unsigned int row, col;
+	int i, len;
+
+	radar_flush_redraw(radar);
+
+	snap = g_new0(pdf_snapshot_t, 1);
+
+	snap->licensed = (NULL != radar->license);
+	snap->range = radar->range;
+	snap->marks = radar_ranges[radar->rindex].marks;
+	snap->digits = radar_ranges[radar->rindex].digits;
+	snap->cx = radar->cx;
+	snap->cy = radar->cy;
+	snap->r = radar->r;
+
+	snap->items = g_array_sized_new(FALSE, TRUE, sizeof(pdf_item_t),
+					radar->display_list->len);
+	g_array_set_size(snap->items, radar->display_list->len);
+
+	for (i = 0; i < radar->display_list->len; i++) {
+		item = &g_array_index(radar->display_list, display_item_t, i);
+		style = &g_array_index(radar->display_styles,
+				       display_style_t, item->style);
+		pi = &g_array_index(snap->items, pdf_item_t, i);
+
+		pi->type = item->type;
+		pi->is_target = item->is_target;
+		pi->rgb = style->rgb;
+		pi->line_width = style->line_width;
+		pi->line_style = style->line_style;
+
+		switch (item->type) {
+		case DISPLAY_VECTOR:
+			vect = item->prim;
+			pi->points[0].x = vect->x1;
+			pi->points[0].y = vect->y1;
+			pi->points[1].x = vect->x2;
+			pi->points[1].y = vect->y2;
+			pi->npoints = 2;
+			break;
+
+		case DISPLAY_ARC:
+			arc = item->prim;
+			pi->points[0].x = arc->x;
+			pi->points[0].y = arc->y;
+			pi->npoints = 1;
+			pi->radius = arc->radius;
+			pi->angle1 = arc->angle1;
+			pi->angle2 = arc->angle2;
+			break;
+
+		case DISPLAY_POLY:
+			poly = item->prim;
+			memcpy(pi->points, poly->points, sizeof(pi->points));
+			pi->npoints = poly->npoints;
+			break;
 
+		case DISPLAY_LABEL:
+			label = item->prim;
+			pi->points[0].x = label->cx;
+			pi->points[0].y = label->cy;
+			pi->npoints = 1;
+			pi->xoff = label->xoff;
+			pi->yoff = label->yoff;
+			pi->xalign = label->xalign;
+			pi->yalign = label->yalign;
+			pi->markup = g_strdup(label->markup);
+			break;
+		}
+	}
 
-	table_columns = 0;
 	for (i = 0; i < RADAR_NR_TARGETS; i++) {
 		target = &radar->target[i];
 
@@ -2015,40 +2108,106 @@ output_table(radar_t *radar, FILE *file, afm_t *afm, double fs, double lw,
 		    (target->distance[1] == 0.0))
 			continue;
 
-		table_columns++;
+		snap->table_columns++;
+	}
+	if (0 == snap->table_columns)
+		snap->table_columns = TABLE_EMPTY_COLUMNS;
+	if (snap->table_columns > TABLE_MAX_COLUMNS)
+		snap->table_columns = TABLE_MAX_COLUMNS;
+
+	for (row = 0; row < NR_DATA_TABLE_ROWS; row++) {
+		dp = &data_table[row];
+
+		if (NULL == dp->get_text)
+			continue;
+
+		for (col = 0; col < dp->columns; col++) {
+			if (col >= snap->table_columns)
+				break;
+
+			len = dp->get_text(radar, col, text, sizeof(text));
+			snap->cells[row][col] = g_strndup((char *) text, len);
+		}
+	}
+
+	if (snap->digits)
+		snap->range_text = g_strdup_printf(_("%.*f nm"),
+						   snap->digits, snap->range);
+	else
+		snap->range_text = g_strdup_printf(_("%.1f nm"), snap->range);
+
+	return snap;
+}
+
+static void
+pdf_snapshot_free(pdf_snapshot_t *snap)
+{
+	pdf_item_t *pi;
+	unsigned int row, col;
+	int i;
+
+	for (i = 0; i < snap->items->len; i++) {
+		pi = &g_array_index(snap->items, pdf_item_t, i);
+		g_free(pi->markup);
+	}
+	g_array_free(snap->items, TRUE);
+
+	for (row = 0; row < NR_DATA_TABLE_ROWS; row++) {
+		for (col = 0; col < TABLE_MAX_COLUMNS; col++)
+			g_free(snap->cells[row][col]);
 	}
-	if (0 == table_columns)
-		table_columns = TABLE_EMPTY_COLUMNS;
-	if (table_columns > TABLE_MAX_COLUMNS)
-		table_columns = TABLE_MAX_COLUMNS;
 
+	g_free(snap->range_text);
+	g_free(snap);
+}
+
+static void
+output_table(pdf_snapshot_t *snap, pdf_strings_t *strings, pdf_t *pdf,
+	     afm_t *afm, double fs, double lw, double width, double height,
+	     pdf_rect_t *annot_rect)
+{
+	const table_descriptor_t *dp;
+	unsigned char text[64], *cell, *p;
+	const char *row_text, *unit;
+	afm_extents_t extents;
+	double rh, x, y, w;
+	double c1w, c2w, asc, desc, th;
+	double predec[TABLE_MAX_COLUMNS];
+	double postdec[TABLE_MAX_COLUMNS];
+	double prewidth, aoffset;
+	unsigned int sep, drow, row, col;
+	unsigned int table_columns;
+	int len, prelen;
+
+
+	table_columns = snap->table_columns;
 
-	offset += fprintf(file, "0 g\n");
-	offset += fprintf(file, "0 G\n");
-	offset += fprintf(file, "%.3f w\n", lw);
+	pdf_op(pdf, "0 g");
+	pdf_op(pdf, "0 G");
+	pdf_op1(pdf, lw, "w");
 
 	sprintf((char *) text, "Radarplot");
 	afm_text_extents(afm, 3.0 * fs, (char *) text,
 			 strlen((char *) text), &extents);
-	offset += afm_print_text(file, afm, 3.0 * fs,
-				 -extents.bbox.llx, height - extents.ascent,
-				 (char *) text, strlen((char *) text));
+	afm_print_text(pdf, afm, 3.0 * fs,
+		       -extents.bbox.llx, height - extents.ascent,
+		       (char *) text, strlen((char *) text));
 
 	sprintf((char *) text, "Copyright  2005 Christian Dost");
 	afm_text_extents(afm, 0.75 * fs, (char *) text,
 			 strlen((char *) text), &extents);
-	offset += afm_print_text(file, afm, 0.75 * fs,
-				 width - extents.bbox.urx,
-				 height - extents.ascent,
-				 (char *) text, strlen((char *) text));
+	afm_print_text(pdf, afm, 0.75 * fs,
+		       width - extents.bbox.urx,
+		       height - extents.ascent,
+		       (char *) text, strlen((char *) text));
 
 	sprintf((char *) text, "ecd@brainaid.de");
 	afm_text_extents(afm, 0.75 * fs, (char *) text,
 			 strlen((char *) text), &extents);
 	x = width - extents.bbox.urx;
 	y = height - 1.25 * 0.75 * fs - extents.ascent;
-	offset += afm_print_text(file, afm, 0.75 * fs,
-				 x, y, (char *) text, strlen((char *) text));
+	afm_print_text(pdf, afm, 0.75 * fs,
+		       x, y, (char *) text, strlen((char *) text));
 	annot_rect[0].llx = x;
 	annot_rect[0].lly = y + extents.descent;
 	annot_rect[0].urx = x + extents.width;
@@ -2059,8 +2218,8 @@ output_table(radar_t *radar, FILE *file, afm_t *afm, double fs, double lw,
 			 strlen((char *) text), &extents);
 	x = width - extents.bbox.urx;
 	y = height - 2.5 * 0.75 * fs - extents.ascent;
-	offset += afm_print_text(file, afm, 0.75 * fs,
-				 x, y, (char *) text, strlen((char *) text));
+	afm_print_text(pdf, afm, 0.75 * fs,
+		       x, y, (char *) text, strlen((char *) text));
 	annot_rect[1].llx = x;
 	annot_rect[1].lly = y + extents.descent;
 	annot_rect[1].urx = x + extents.width;
@@ -2082,7 +2241,7 @@ output_table(radar_t *radar, FILE *file, afm_t *afm, double fs, double lw,
 			drow++;
 
 		if (dp->row) {
-			row_text = (dp->row[0] == '\0') ? "" : _(dp->row);
+			row_text = strings->row[row];
 
 			afm_text_extents(afm, fs, (char *) row_text,
 					 strlen((char *) row_text), &extents);
@@ -2098,11 +2257,9 @@ output_table(radar_t *radar, FILE *file, afm_t *afm, double fs, double lw,
 		}
 
 		if (dp->unit) {
-			snprintf((char *) unit, sizeof(unit), "[%s]",
-				 (dp->unit[0] == '\0') ? "" : _(dp->unit));
+			unit = strings->unit[row];
 
-			afm_text_extents(afm, fs, (char *) unit,
-					 strlen((char *) unit), &extents);
+			afm_text_extents(afm, fs, unit, strlen(unit), &extents);
 
 			if (dp->columns > 0) {
 				if (extents.width > c2w)
@@ -2119,21 +2276,21 @@ output_table(radar_t *radar, FILE *file, afm_t *afm, double fs, double lw,
 			if (col >= table_columns)
 				continue;
 
-			if (dp->get_text) {
-				len = dp->get_text(radar, col,
-						   text, sizeof(text));
+			cell = (unsigned char *) snap->cells[row][col];
+			if (cell) {
+				len = strlen((char *) cell);
 
 				if (dp->alignment & TABLE_ALIGN_DECIMAL) {
-					p = (unsigned char *) strchr((char *) text, '.');
+					p = (unsigned char *) strchr((char *) cell, '.');
 					if (NULL == p)
-						p = first_non_digit(text);
+						p = first_non_digit(cell);
 					if (NULL == p) {
-						afm_text_extents(afm, fs, (char *) text, len, &extents);
+						afm_text_extents(afm, fs, (char *) cell, len, &extents);
 						if (extents.width > predec[col])
 							predec[col] = extents.width;
 					} else {
-						prelen = p - text;
-						afm_text_extents(afm, fs, (char *) text, prelen, &extents);
+						prelen = p - cell;
+						afm_text_extents(afm, fs, (char *) cell, prelen, &extents);
 						if (extents.width > predec[col])
 							predec[col] = extents.width;
 						afm_text_extents(afm, fs, (char *) p, len - prelen, &extents);
@@ -2162,7 +2319,7 @@ output_table(radar_t *radar, FILE *file, afm_t *afm, double fs, double lw,
 			continue;
 		}
 
-		row_text = (dp->row[0] == '\0') ? "" : _(dp->row);
+		row_text = strings->row[row];
 
 		y -= rh;
 		x = 0.0;
@@ -2171,38 +2328,36 @@ output_table(radar_t *radar, FILE *file, afm_t *afm, double fs, double lw,
 			afm_text_extents(afm, fs, (char *) row_text,
 					 strlen((char *) row_text), &extents);
 
-			offset += afm_print_text(file, afm, fs,
-						 x - extents.bbox.llx, y + th,
-						 (char *) row_text,
-						 strlen((char *) row_text));
+			afm_print_text(pdf, afm, fs,
+				       x - extents.bbox.llx, y + th,
+				       (char *) row_text,
+				       strlen((char *) row_text));
 			continue;
 		}
 
-		offset += fprintf(file, "%.3f %.3f m\n", x, y);
-		offset += fprintf(file, "%.3f %.3f l\n", x + width, y);
-		offset += fprintf(file, "%.3f %.3f l\n", x + width, y + rh);
-		offset += fprintf(file, "%.3f %.3f l\n", x, y + rh);
-		offset += fprintf(file, "s\n");
+		pdf_op2(pdf, x, y, "m");
+		pdf_op2(pdf, x + width, y, "l");
+		pdf_op2(pdf, x + width, y + rh, "l");
+		pdf_op2(pdf, x, y + rh, "l");
+		pdf_op(pdf, "s");
 
-		offset += afm_print_text(file, afm, fs,
-					 x + fs / 2.0, y + th,
-					 (char *) row_text,
-					 strlen((char *) row_text));
+		afm_print_text(pdf, afm, fs,
+			       x + fs / 2.0, y + th,
+			       (char *) row_text,
+			       strlen((char *) row_text));
 
 		x = c1w;
 
-		offset += fprintf(file, "%.3f %.3f m\n", x, y);
-		offset += fprintf(file, "%.3f %.3f l\n", x, y + rh);
-		offset += fprintf(file, "S\n");
+		pdf_op2(pdf, x, y, "m");
+		pdf_op2(pdf, x, y + rh, "l");
+		pdf_op(pdf, "S");
 
 		if (dp->unit) {
-			snprintf((char *) unit, sizeof(unit), "[%s]",
-				 (dp->unit[0] == '\0') ? "" : _(dp->unit));
+			unit = strings->unit[row];
 
-			offset += afm_print_text(file, afm, fs,
-						 x + fs / 2.0, y + th,
-						 (char *) unit,
-						 strlen((char *) unit));
+			afm_print_text(pdf, afm, fs,
+				       x + fs / 2.0, y + th,
+				       unit, strlen(unit));
 		}
 
 		x += c2w;
@@ -2213,26 +2368,26 @@ output_table(radar_t *radar, FILE *file, afm_t *afm, double fs, double lw,
 			if (col >= table_columns)
 				continue;
 
-			offset += fprintf(file, "%.3f %.3f m\n", x, y);
-			offset += fprintf(file, "%.3f %.3f l\n", x, y + rh);
-			offset += fprintf(file, "S\n");
+			pdf_op2(pdf, x, y, "m");
+			pdf_op2(pdf, x, y + rh, "l");
+			pdf_op(pdf, "S");
 
-			if (dp->get_text) {
-				len = dp->get_text(radar, col,
-						   text, sizeof(text));
+			cell = (unsigned char *) snap->cells[row][col];
+			if (cell) {
+				len = strlen((char *) cell);
 
 				aoffset = 0.0;
 
 				if (dp->alignment & TABLE_ALIGN_DECIMAL) {
-					p = (unsigned char *) strchr((char *) text, '.');
+					p = (unsigned char *) strchr((char *) cell, '.');
 					if (NULL == p)
-						p = first_non_digit(text);
+						p = first_non_digit(cell);
 					if (NULL == p)
 						prelen = len;
 					else
-						prelen = p - text;
+						prelen = p - cell;
 
-					afm_text_extents(afm, fs, (char *) text, prelen, &extents);
+					afm_text_extents(afm, fs, (char *) cell, prelen, &extents);
 					prewidth = extents.width;
 
 					switch (dp->alignment & TABLE_ALIGN_MASK) {
@@ -2247,7 +2402,7 @@ output_table(radar_t *radar, FILE *file, afm_t *afm, double fs, double lw,
 						break;
 					}
 				} else {
-					afm_text_extents(afm, fs, (char *) text, len, &extents);
+					afm_text_extents(afm, fs, (char *) cell, len, &extents);
 
 					switch (dp->alignment & TABLE_ALIGN_MASK) {
 					case TABLE_ALIGN_LEFT:
@@ -2262,76 +2417,48 @@ output_table(radar_t *radar, FILE *file, afm_t *afm, double fs, double lw,
 					}
 				}
 
-				offset += afm_print_text(file, afm, fs,
-							 x + fs / 2.0 + aoffset,
-							 y + th,
-							 (char *) text, len);
+				afm_print_text(pdf, afm, fs,
+					       x + fs / 2.0 + aoffset,
+					       y + th,
+					       (char *) cell, len);
 			}
 
 			x += w;
 		}
 	}
-
-	return offset;
 }
 
 #ifdef DEBUG_LABEL_ALIGN
 
-static int
-pdf_output_align(FILE *file, double x, double y)
+static void
+pdf_output_align(pdf_t *pdf, double x, double y)
 {
-	int offset = 0;
-
-	offset += fprintf(file, "%.3f w\n", 0.0);
+	pdf_op1(pdf, 0.0, "w");
 
-	offset += fprintf(file, "%.3f %.3f m\n",
-			  x - 20.0, y);
-	offset += fprintf(file, "%.3f %.3f l\n",
-			  x + 20.0, y);
-	offset += fprintf(file, "S\n");
+	pdf_op2(pdf, x - 20.0, y, "m");
+	pdf_op2(pdf, x + 20.0, y, "l");
+	pdf_op(pdf, "S");
 
-	offset += fprintf(file, "%.3f %.3f m\n",
-			  x, y - 10.0);
-	offset += fprintf(file, "%.3f %.3f l\n",
-			  x, y + 10.0);
-	offset += fprintf(file, "S\n");
-
-	return offset;
+	pdf_op2(pdf, x, y - 10.0, "m");
+	pdf_op2(pdf, x, y + 10.0, "l");
+	pdf_op(pdf, "S");
 }
 
-static int
-pdf_output_bbox(FILE *file, double x, double y, afm_extents_t *extents)
-{
-	int offset = 0;
-
-	offset += fprintf(file, "%.3f w\n", 0.0);
-
-	offset += fprintf(file, "%.3f %.3f m\n",
-			  x + extents->bbox.llx,
-			  y + extents->bbox.lly);
-	offset += fprintf(file, "%.3f %.3f l\n",
-			  x + extents->bbox.urx,
-			  y + extents->bbox.lly);
-	offset += fprintf(file, "%.3f %.3f l\n",
-			  x + extents->bbox.urx,
-			  y + extents->bbox.ury);
-	offset += fprintf(file, "%.3f %.3f l\n",
-			  x + extents->bbox.llx,
-			  y + extents->bbox.ury);
-	offset += fprintf(file, "%.3f %.3f l\n",
-			  x + extents->bbox.llx,
-			  y + extents->bbox.lly);
-	offset += fprintf(file, "S\n");
-
-	offset += fprintf(file, "%.3f %.3f m\n",
-			  x,
-			  y);
-	offset += fprintf(file, "%.3f %.3f l\n",
-			  x + extents->width,
-			  y);
-	offset += fprintf(file, "S\n");
-
-	return offset;
+static void
+pdf_output_bbox(pdf_t *pdf, double x, double y, afm_extents_t *extents)
+{
+	pdf_op1(pdf, 0.0, "w");
+
+	pdf_op2(pdf, x + extents->bbox.llx, y + extents->bbox.lly, "m");
+	pdf_op2(pdf, x + extents->bbox.urx, y + extents->bbox.lly, "l");
+	pdf_op2(pdf, x + extents->bbox.urx, y + extents->bbox.ury, "l");
+	pdf_op2(pdf, x + extents->bbox.llx, y + extents->bbox.ury, "l");
+	pdf_op2(pdf, x + extents->bbox.llx, y + extents->bbox.lly, "l");
+	pdf_op(pdf, "S");
+
+	pdf_op2(pdf, x, y, "m");
+	pdf_op2(pdf, x + extents->width, y, "l");
+	pdf_op(pdf, "S");
 }
 
 #endif /* DEBUG_LABEL_ALIGN */
@@ -2354,285 +2481,136 @@ pdf_label_align(double xalign, double yalign, afm_extents_t *extents,
 	*yoffp = yoff;
 }
 
-int
-radar_print_as_PDF(radar_t *radar, const char *filename,
-		   const char *paper, int color)
+typedef struct {
+	pdf_t		*pdf;
+	afm_t		*afm;
+	pdf_strings_t	*strings;
+	const char	*filename;
+	unsigned int	paper_width;
+	unsigned int	paper_height;
+
+	unsigned int	catalog;
+	unsigned int	outlines;
+	unsigned int	pages;
+	unsigned int	procset;
+	unsigned int	font;
+	unsigned int	encoding;
+	unsigned int	info;
+	unsigned int	uri[2];
+	unsigned int	rose;
+
+	int		color;
+	double		w, h;		/* page geometry in mm */
+	double		fs, lw;
+	double		step;		/* range ring distance */
+	double		nw, nh;		/* bearing label size */
+
+	GArray		*kids;		/* page object numbers */
+} pdf_report_t;
+
+/*
+ * Range rings, bearing scale and the log scale look the same on every
+ * page of a report, they are written once as Form XObject /Rose.
+ */
+static int
+pdf_report_rose(pdf_report_t *report)
 {
-	unsigned int catalog, outlines, pages, page, content, stream, length;
-	unsigned int procset, font, encoding, info, uri[2], annot[2], annots;
-	unsigned int xref, offset;
-	unsigned int paper_width = 0, paper_height = 0;
-	static const char *source_date = "$Date: 2009-07-24 11:37:17 $";
-	pdf_rect_t annot_rect[2];
-	char *fontname, font_afm_file[1024];
-	double step, fs, x, y, w, h, r, lw, xoff, yoff;
-	double nw, nh, sw, xoffset, yoffset;
 	unsigned char text[32];
-	const char *p;
-	afm_extents_t extents;
-	GdkGCValues values;
-	target_t *target;
-	vector_t *vect;
-	arc_t *arc;
-	poly_t *poly;
-	text_label_t *label;
-	unsigned int c;
-	struct tm *tm0, *tm1;
-	time_t t, tz;
-	FILE *file;
-	afm_t *afm;
-	int i, j, k, a;
-
-	fontname = "Helvetica";
-
-	for (i = 0; i < NR_PAPER_FORMATS; i++) {
-		if (!strcmp(paper, paper_formats[i].name)) {
-			paper_width = paper_formats[i].pt_width;
-			paper_height = paper_formats[i].pt_height;
-			break;
-		}
-	}
-	if ((paper_width == 0) || (paper_height == 0)) {
-		fprintf(stderr, "%s:%u: unknown paper format '%s'\n",
-			__FUNCTION__, __LINE__, paper);
-		return -1;
-	}
-
-	w = 25.4 * (double) paper_width / 72.0;
-	h = 25.4 * (double) paper_height / 72.0;
-	fs = h / 90.0;
-	lw = 0.25;
+	double x, y, r, xoffset, yoffset;
+	double w = report->w, h = report->h;
+	double fs = report->fs, lw = report->lw;
+	double step = report->step;
+	double nw = report->nw, nh = report->nh;
+	int color = report->color;
+	pdf_t *pdf = report->pdf;
+	afm_t *afm = report->afm;
+	char *dict;
+	int i, a, ret;
+
+	pdf_begin_stream(pdf);
 
-	step = floor(((h - 20.0) - 8.0 * fs - 8.0) / 12.0 + 0.5);
+	xoffset = 6.0 * step + nw + nh / 2.0 + 10.0;
+	yoffset = h - (6.0 * step + nh + nh / 2.0 + 10.0);
 
-#ifdef __WIN32__
-{
-	char *path = g_build_filename(progpath, fontname, NULL);
-	sprintf(font_afm_file, "%s.afm", path);
-	g_free(path);
-}
-#else /* __WIN32__ */
-	sprintf(font_afm_file, "%s/share/radarplot/%s.afm", PREFIX, fontname);
-#endif /* __WIN32__ */
-	if (afm_read_file(font_afm_file, &afm) < 0) {
-		fprintf(stderr, "%s:%u: can't read '%s': %s\n",
-			__FUNCTION__, __LINE__,
-			font_afm_file, strerror(errno));
-		return -1;
-	}
-	afm->pdf_name = "Fn";
+	pdf_op(pdf, "q");
+	pdf_translate(pdf, xoffset, yoffset);
 
-	pdf_char_bullet = afm_lookup_char_by_name(afm, "bullet", 6);
-	if (NULL == pdf_char_bullet) {
-		fprintf(stderr, "%s:%u: can't find char 'bullet'\n",
-			__FUNCTION__, __LINE__);
-		return -1;
-	}
+	pdf_op1(pdf, lw / 2.0, "w");	/* lineWidth */
+	pdf_op(pdf, "1 J");		/* lineCap: Round */
+	pdf_op(pdf, "1 j");		/* lineJoin: Round */
 
-	c = 128;
-	while (afm->char_table[c].ch)
-		c++;
+	if (color)
+		pdf_op1(pdf, 0.75, "G");	/* 25% Gray */
 
-	pdf_char_bullet->index = c;
-	afm->char_table[c].ch = pdf_char_bullet;
+	for (a = 0; a < 360; a += 10) {
+		if (0 == (a % 30))
+			continue;
 
-	afm_text_extents(afm, fs, "270", 3, &extents);
-	nh = extents.bbox.ury - extents.bbox.lly;
-	nw = extents.bbox.urx - extents.bbox.llx;
+		x = 3.0 * step * cos(M_PI * (double) a / 180.0) / 4.0;
+		y = 3.0 * step * sin(M_PI * (double) a / 180.0) / 4.0;
+		pdf_op2(pdf, x, y, "m");
 
+		x = 6.0 * step * cos(M_PI * (double) a / 180.0);
+		y = 6.0 * step * sin(M_PI * (double) a / 180.0);
+		pdf_op2(pdf, x, y, "l");
 
-	file = fopen(filename, "wb");
-	if (NULL == file) {
-		fprintf(stderr, "%s:%u: open '%s': %s\n",
-			__FUNCTION__, __LINE__, filename, strerror(errno));
-		afm_free(afm);
-		return -1;
+		pdf_op(pdf, "S");
 	}
 
-	offset = 0;
-	offset += fprintf(file, "%%PDF-1.3\n");
-
-	catalog = offset;
-	offset += fprintf(file, "1 0 obj\n");
-	offset += fprintf(file, "   << /Type /Catalog\n");
-	offset += fprintf(file, "      /Outlines 2 0 R\n");
-	offset += fprintf(file, "      /Pages 3 0 R\n");
-	offset += fprintf(file, "   >>\n");
-	offset += fprintf(file, "endobj\n");
-	offset += fprintf(file, "\n");
-
-	outlines = offset;
-	offset += fprintf(file, "2 0 obj\n");
-	offset += fprintf(file, "   << /Type /Outlines\n");
-	offset += fprintf(file, "      /Count 0\n");
-	offset += fprintf(file, "   >>\n");
-	offset += fprintf(file, "endobj\n");
-	offset += fprintf(file, "\n");
-
-	pages = offset;
-	offset += fprintf(file, "3 0 obj\n");
-	offset += fprintf(file, "   << /Type /Pages\n");
-	offset += fprintf(file, "      /Kids [4 0 R]\n");
-	offset += fprintf(file, "      /Count 1\n");
-	offset += fprintf(file, "   >>\n");
-	offset += fprintf(file, "endobj\n");
-	offset += fprintf(file, "\n");
-
-	page = offset;
-	offset += fprintf(file, "4 0 obj\n");
-	offset += fprintf(file, "   << /Type /Page\n");
-	offset += fprintf(file, "      /MediaBox [ 0 0 %u %u ]\n",
-			  paper_width, paper_height);
-	offset += fprintf(file, "      /CropBox [ 0 0 %u %u ]\n",
-			  paper_width, paper_height);
-	offset += fprintf(file, "      /Rotate   0\n");
-	offset += fprintf(file, "      /Parent 3 0 R\n");
-	offset += fprintf(file, "      /Contents 5 0 R\n");
-	offset += fprintf(file, "      /Annots 15 0 R\n");
-	offset += fprintf(file, "      /Resources\n");
-	offset += fprintf(file, "         << /ProcSet 7 0 R\n");
-	offset += fprintf(file, "            /Font\n");
-	offset += fprintf(file, "               << /%s 8 0 R >>\n",
-			  afm->pdf_name);
-	offset += fprintf(file, "         >>\n");
-	offset += fprintf(file, "   >>\n");
-	offset += fprintf(file, "endobj\n");
-	offset += fprintf(file, "\n");
-
-	content = offset;
-	offset += fprintf(file, "5 0 obj\n");
-	offset += fprintf(file, "   << /Length 6 0 R >>\n");
-	offset += fprintf(file, "stream\n");
-
-
-	stream = 0;
-	stream += fprintf(file, "q\n");
-	stream += fprintf(file, "%.8f 0 0 %.8f 0 0 cm\n",
-			  72.0 / 25.4, 72.0 / 25.4);
+	if (color)
+		pdf_op1(pdf, 0.5, "G");	/* 50% Gray */
 
-	xoffset = 6.0 * step + nw + nh / 2.0 + 10.0;
-	yoffset = h - (6.0 * step + nh + nh / 2.0 + 10.0);
+	for (a = 0; a < 360; a += 5) {
+		x = (6.0 - 1.0 / 6.0) * step * cos(M_PI * (double) a / 180.0);
+		y = (6.0 - 1.0 / 6.0) * step * sin(M_PI * (double) a / 180.0);
+		pdf_op2(pdf, x, y, "m");
 
-	stream += fprintf(file, "1 0 0 1 %.3f %.3f cm\n", xoffset, yoffset);
+		x = 6.0 * step * cos(M_PI * (double) a / 180.0);
+		y = 6.0 * step * sin(M_PI * (double) a / 180.0);
+		pdf_op2(pdf, x, y, "l");
 
-	stream += fprintf(file, "%.3f w\n", lw / 2.0);	/* lineWidth */
-	stream += fprintf(file, "1 J\n");		/* lineCap: Round */
-	stream += fprintf(file, "1 j\n");		/* lineJoin: Round */
+		pdf_op(pdf, "S");
+	}
 
-
-	if (NULL == radar->license) {
-		stream += fprintf(file, "q\n");
-
-		sprintf((char *) text, _("Radarplot %u.%u.%u (unregistered)"),
-			RADAR_MAJOR, RADAR_MINOR, RADAR_PATCHLEVEL);
-
-		/* calculate extents, calculate scale from that. */
-		afm_text_extents(afm, 7.0 * fs, (char *) text,
-				 strlen((char *) text), &extents);
-
-		/* rotate */
-		stream += fprintf(file, "%.8f %.8f %.8f %.8f 0 0 cm\n",
-				  cos(M_PI/4.0), sin(M_PI/4.0),
-				  -sin(M_PI/4.0), cos(M_PI/4.0));
-
-		/* translate */
-		x = -extents.width / 2.0;
-		y = -extents.ascent / 2.0;
-
-		stream += fprintf(file, "1 0 0 1 %.3f %.3f cm\n", x, y);
-
-		/* 25% grey */
-		stream += fprintf(file, "%.3f g\n", 0.75);
-
-		stream += afm_print_text(file, afm, 7.0 * fs, 0.0, 0.0,
-					 (char *) text, strlen((char *) text));
-
-		stream += fprintf(file, "Q\n");
-	}
-
-
-	if (color)
-		stream += fprintf(file, "%.3f G\n", 0.75);	/* 25% Gray */
-
-	for (a = 0; a < 360; a += 10) {
-		if (0 == (a % 30))
-			continue;
-
-		x = 3.0 * step * cos(M_PI * (double) a / 180.0) / 4.0;
-		y = 3.0 * step * sin(M_PI * (double) a / 180.0) / 4.0;
-		stream += fprintf(file, "%.3f %.3f m\n", x, y);
-
-		x = 6.0 * step * cos(M_PI * (double) a / 180.0);
-		y = 6.0 * step * sin(M_PI * (double) a / 180.0);
-		stream += fprintf(file, "%.3f %.3f l\n", x, y);
-
-		stream += fprintf(file, "S\n");
-	}
-
-	if (color)
-		stream += fprintf(file, "%.3f G\n", 0.5);	/* 50% Gray */
-
-	for (a = 0; a < 360; a += 5) {
-		x = (6.0 - 1.0 / 6.0) * step * cos(M_PI * (double) a / 180.0);
-		y = (6.0 - 1.0 / 6.0) * step * sin(M_PI * (double) a / 180.0);
-		stream += fprintf(file, "%.3f %.3f m\n", x, y);
-
-		x = 6.0 * step * cos(M_PI * (double) a / 180.0);
-		y = 6.0 * step * sin(M_PI * (double) a / 180.0);
-		stream += fprintf(file, "%.3f %.3f l\n", x, y);
-
-		stream += fprintf(file, "S\n");
-	}
-
-	for (a = 0; a < 360; a++) {
-		if (0 == (a % 5))
-			continue;
+	for (a = 0; a < 360; a++) {
+		if (0 == (a % 5))
+			continue;
 
 		x = (6.0 - 1.0 / 12.0) * step * cos(M_PI * (double) a / 180.0);
 		y = (6.0 - 1.0 / 12.0) * step * sin(M_PI * (double) a / 180.0);
-		stream += fprintf(file, "%.3f %.3f m\n", x, y);
+		pdf_op2(pdf, x, y, "m");
 
 		x = 6.0 * step * cos(M_PI * (double) a / 180.0);
 		y = 6.0 * step * sin(M_PI * (double) a / 180.0);
-		stream += fprintf(file, "%.3f %.3f l\n", x, y);
+		pdf_op2(pdf, x, y, "l");
 
-		stream += fprintf(file, "S\n");
+		pdf_op(pdf, "S");
 	}
 
 	if (color)
-		stream += fprintf(file, "%.3f G\n", 0.75);	/* 25% Gray */
+		pdf_op1(pdf, 0.75, "G");	/* 25% Gray */
 
 	for (i = 0; i < 6; i++) {
 		r = step * ((double) i + 0.5);
 
-		x = r * cos(M_PI * (double) 0 / 180.0);
-		y = r * sin(M_PI * (double) 0 / 180.0);
-		stream += fprintf(file, "%.3f %.3f m\n", x, y);
-
-		for (a = 1; a < 360; a++) {
-			x = r * cos(M_PI * (double) a / 180.0);
-			y = r * sin(M_PI * (double) a / 180.0);
-
-			stream += fprintf(file, "%.3f %.3f l\n", x, y);
-		}
-
-		stream += fprintf(file, "s\n");
+		output_arc_path(pdf, 0.0, 0.0, r, 0.0, 360.0);
+		pdf_op(pdf, "s");
 	}
 
-	stream += fprintf(file, "%.3f w\n", lw);	/* lineWidth */
+	pdf_op1(pdf, lw, "w");	/* lineWidth */
 	if (color)
-		stream += fprintf(file, "%.3f G\n", 0.5);	/* 50% Gray */
+		pdf_op1(pdf, 0.5, "G");	/* 50% Gray */
 
 	for (a = 0; a < 360; a += 90) {
 		x = 0.0;
 		y = 0.0;
-		stream += fprintf(file, "%.3f %.3f m\n", x, y);
+		pdf_op2(pdf, x, y, "m");
 
 		x = 6.0 * step * cos(M_PI * (double) a / 180.0);
 		y = 6.0 * step * sin(M_PI * (double) a / 180.0);
-		stream += fprintf(file, "%.3f %.3f l\n", x, y);
+		pdf_op2(pdf, x, y, "l");
 
-		stream += fprintf(file, "S\n");
+		pdf_op(pdf, "S");
 	}
 
 	for (a = 0; a < 360; a += 30) {
@@ -2641,34 +2619,24 @@ radar_print_as_PDF(radar_t *radar, const char *filename,
 
 		x = 1.0 * step * cos(M_PI * (double) a / 180.0) / 4.0;
 		y = 1.0 * step * sin(M_PI * (double) a / 180.0) / 4.0;
-		stream += fprintf(file, "%.3f %.3f m\n", x, y);
+		pdf_op2(pdf, x, y, "m");
 
 		x = 6.0 * step * cos(M_PI * (double) a / 180.0);
 		y = 6.0 * step * sin(M_PI * (double) a / 180.0);
-		stream += fprintf(file, "%.3f %.3f l\n", x, y);
+		pdf_op2(pdf, x, y, "l");
 
-		stream += fprintf(file, "S\n");
+		pdf_op(pdf, "S");
 	}
 
 	for (i = 0; i < 6; i++) {
 		r = step * (double) (i + 1);
 
-		x = r * cos(M_PI * (double) 0 / 180.0);
-		y = r * sin(M_PI * (double) 0 / 180.0);
-		stream += fprintf(file, "%.3f %.3f m\n", x, y);
-
-		for (a = 1; a < 360; a++) {
-			x = r * cos(M_PI * (double) a / 180.0);
-			y = r * sin(M_PI * (double) a / 180.0);
-
-			stream += fprintf(file, "%.3f %.3f l\n", x, y);
-		}
-
-		stream += fprintf(file, "s\n");
+		output_arc_path(pdf, 0.0, 0.0, r, 0.0, 360.0);
+		pdf_op(pdf, "s");
 	}
 
 	if (color)
-		stream += fprintf(file, "%.3f G\n", 0.0);	/* Black */
+		pdf_op1(pdf, 0.0, "G");	/* Black */
 
 
 
@@ -2681,271 +2649,512 @@ radar_print_as_PDF(radar_t *radar, const char *filename,
 		x -= nw / 2.0;
 		y -= nh / 2.0;
 
-		stream += afm_print_text(file, afm, fs, x, y, (char *) text, 3);
+		afm_print_text(pdf, afm, fs, x, y, (char *) text, 3);
 	}
 
+	pdf_op(pdf, "Q");
+
+	xoffset -= 6.0 * step;
+	yoffset = 10.0 + nh + step / 24.0;
+
+	pdf_op(pdf, "q");
+	pdf_translate(pdf, xoffset, yoffset);
 
-	stream += fprintf(file, "0.5 w\n");
+	output_log_scale(pdf, afm, (const char **) report->strings->scale,
+			 0.75 * fs, lw, w - xoffset - 10.0, step / 6.0,
+			 0.1, 60.0);
 
-	for (a = 0; a < 360; a += 90) {
+	pdf_op(pdf, "Q");
 
-		for (i = 1; i < 6; i++) {
-			if (radar_ranges[radar->rindex].marks == 3) {
-				if (i % 2)
-					continue;
-			}
+	dict = g_strdup_printf("      /Type /XObject\n"
+			       "      /Subtype /Form\n"
+			       "      /BBox [ 0 0 %.3f %.3f ]\n"
+			       "      /Resources\n"
+			       "         << /ProcSet %u 0 R\n"
+			       "            /Font\n"
+			       "               << /%s %u 0 R >>\n"
+			       "         >>\n",
+			       w, h, report->procset,
+			       afm->pdf_name, report->font);
 
-			if (radar->range > 3.0)
-				sprintf((char *) text, "%u", (unsigned int)
-					((double) i * radar->range) / 6);
-			else
-				sprintf((char *) text, "%.*f",
-					radar_ranges[radar->rindex].digits,
-					(double) i * radar->range / 6.0);
+	ret = pdf_end_stream(pdf, report->rose, dict);
 
-			r = step * (double) i;
+	g_free(dict);
+	return ret;
+}
 
-			x = r * sin(M_PI * (double) a / 180.0);
-			y = r * cos(M_PI * (double) a / 180.0);
+/*
+ * Metrics compiled in by afmgen, other fonts are read from their AFM
+ * file.
+ */
+static const struct {
+	const char		*name;
+	const afm_font_data_t	*data;
+} pdf_builtin_fonts[] =
+{
+	{ "Helvetica",	&afm_Helvetica },
+};
+#define NR_PDF_BUILTIN_FONTS \
+	(sizeof(pdf_builtin_fonts) / sizeof(pdf_builtin_fonts[0]))
 
-			afm_text_extents(afm, fs, (char *) text,
-					 strlen((char *) text), &extents);
+/*
+ * Font metrics stay loaded for the life of the process.  Entries are
+ * complete when they are added, only their markup memo changes later,
+ * under the afm_t's own markup_lock.
+ */
+G_LOCK_DEFINE_STATIC(pdf_fonts);
+static GHashTable *pdf_fonts;
 
-			x -= extents.bbox.llx +
-				(extents.bbox.urx - extents.bbox.llx) / 2.0;
-			y -= extents.ascent / 2.0;
+static afm_t *
+pdf_font_lookup(const char *fontname)
+{
+	char font_afm_file[1024];
+	unsigned int i;
+	afm_t *afm;
 
-			stream += fprintf(file, "1 g\n");
-			stream += fprintf(file, "1 G\n");
-			stream += fprintf(file, "%.3f %.3f m\n",
-					  x + extents.bbox.llx,
-					  y + extents.bbox.lly);
-			stream += fprintf(file, "%.3f %.3f l\n",
-					  x + extents.bbox.urx,
-					  y + extents.bbox.lly);
-			stream += fprintf(file, "%.3f %.3f l\n",
-					  x + extents.bbox.urx,
-					  y + extents.bbox.ury);
-			stream += fprintf(file, "%.3f %.3f l\n",
-					  x + extents.bbox.llx,
-					  y + extents.bbox.ury);
-			stream += fprintf(file, "b\n");
-			stream += fprintf(file, "0 g\n");
-			stream += fprintf(file, "0 G\n");
-			stream += afm_print_text(file, afm, fs, x, y,
-						 (char *) text,
-						 strlen((char *) text));
+	G_LOCK(pdf_fonts);
+
+	if (NULL == pdf_fonts)
+		pdf_fonts = g_hash_table_new(g_str_hash, g_str_equal);
+
+	afm = g_hash_table_lookup(pdf_fonts, fontname);
+	if (afm)
+		goto out;
+
+#ifdef __WIN32__
+{
+	char *path = g_build_filename(progpath, fontname, NULL);
+	sprintf(font_afm_file, "%s.afm", path);
+	g_free(path);
+}
+#else /* __WIN32__ */
+	sprintf(font_afm_file, "%s/share/radarplot/%s.afm", PREFIX, fontname);
+#endif /* __WIN32__ */
+
+	for (i = 0; i < NR_PDF_BUILTIN_FONTS; i++) {
+		if (!strcmp(fontname, pdf_builtin_fonts[i].name))
+			break;
+	}
+	if (i < NR_PDF_BUILTIN_FONTS) {
+		if (afm_from_table(pdf_builtin_fonts[i].data, &afm) < 0) {
+			afm = NULL;
+			goto out;
 		}
+		goto loaded;
 	}
 
-	for (i = 0; i < RADAR_NR_VECTORS; i++) {
-		vect = &radar->vectors[i];
+	if (afm_read_file(font_afm_file, &afm) < 0) {
+		fprintf(stderr, "%s:%u: can't read '%s': %s\n",
+			__FUNCTION__, __LINE__,
+			font_afm_file, strerror(errno));
+		afm = NULL;
+		goto out;
+	}
 
-		if (!vect->is_visible)
-			continue;
+loaded:
+	afm->pdf_name = "Fn";
 
-		if (color)
-			stream += output_gc_rgb_color(file, vect->gc);
+	pdf_char_bullet = afm_lookup_char_by_name(afm, "bullet", 6);
+	if (NULL == pdf_char_bullet) {
+		fprintf(stderr, "%s:%u: can't find char 'bullet'\n",
+			__FUNCTION__, __LINE__);
+		afm_free(afm);
+		afm = NULL;
+		goto out;
+	}
 
-		gdk_gc_get_values(vect->gc, &values);
+	if (afm_encode_char(afm, pdf_char_bullet) < 0) {
+		afm_free(afm);
+		afm = NULL;
+		goto out;
+	}
 
-		if (values.line_width == 0)
-			stream += fprintf(file, "%.3f w\n", lw);
-		else
-			stream += fprintf(file, "%.3f w\n",
-					  (double) values.line_width * lw);
+	g_hash_table_insert(pdf_fonts, g_strdup(fontname), afm);
 
-		if (values.line_style == GDK_LINE_ON_OFF_DASH)
-			stream += fprintf(file, "[1 1] 0 d\n");
+out:
+	G_UNLOCK(pdf_fonts);
+	return afm;
+}
 
-		translate_point(vect->x1, vect->y1,
-				radar->cx, radar->cy, radar->r,
-				0.0, 0.0, 6.0 * step, &x, &y);
-		stream += fprintf(file, "%.3f %.3f m\n", x, -y);
+static void
+pdf_report_abort(pdf_report_t *report)
+{
+	pdf_free(report->pdf);
+	g_array_free(report->kids, TRUE);
 
-		translate_point(vect->x2, vect->y2,
-				radar->cx, radar->cy, radar->r,
-				0.0, 0.0, 6.0 * step, &x, &y);
-		stream += fprintf(file, "%.3f %.3f l\n", x, -y);
+	unlink(report->filename);
+}
 
-		stream += fprintf(file, "S\n");
+/*
+ * Objects used by every page (font, encoding, procset, links) are
+ * numbered here and written once.  Pages go to the file as they are
+ * finished, only the xref and the page list grow with the report.
+ */
+static int
+pdf_report_begin(pdf_report_t *report, pdf_strings_t *strings,
+		 const char *filename, const char *paper, int color)
+{
+	afm_extents_t extents;
+	char *fontname;
+	pdf_t *pdf;
+	afm_t *afm;
+	int i;
+
+	memset(report, 0, sizeof(pdf_report_t));
+
+	fontname = PDF_FONT_NAME;
 
-		if (values.line_style == GDK_LINE_ON_OFF_DASH)
-			stream += fprintf(file, "[] 0 d\n");
+	for (i = 0; i < NR_PAPER_FORMATS; i++) {
+		if (!strcmp(paper, paper_formats[i].name)) {
+			report->paper_width = paper_formats[i].pt_width;
+			report->paper_height = paper_formats[i].pt_height;
+			break;
+		}
+	}
+	if ((report->paper_width == 0) || (report->paper_height == 0)) {
+		fprintf(stderr, "%s:%u: unknown paper format '%s'\n",
+			__FUNCTION__, __LINE__, paper);
+		return -1;
 	}
 
-	for (i = 0; i < RADAR_NR_TARGETS; i++) {
-		target = &radar->target[i];
+	afm = pdf_font_lookup(fontname);
+	if (NULL == afm)
+		return -1;
 
-		for (j = 0; j < TARGET_NR_VECTORS; j++) {
-			vect = &target->vectors[j];
+	pdf = pdf_open(filename);
+	if (NULL == pdf)
+		return -1;
 
-			if (!vect->is_visible)
-				continue;
+	report->pdf = pdf;
+	report->afm = afm;
+	report->strings = strings;
+	report->filename = filename;
+	report->color = color;
+
+	report->w = 25.4 * (double) report->paper_width / 72.0;
+	report->h = 25.4 * (double) report->paper_height / 72.0;
+	report->fs = report->h / 90.0;
+	report->lw = 0.25;
+
+	report->step = floor(((report->h - 20.0) - 8.0 * report->fs - 8.0)
+			     / 12.0 + 0.5);
+
+	afm_text_extents(afm, report->fs, "270", 3, &extents);
+	report->nh = extents.bbox.ury - extents.bbox.lly;
+	report->nw = extents.bbox.urx - extents.bbox.llx;
+
+	report->kids = g_array_new(FALSE, FALSE, sizeof(unsigned int));
+
+	report->catalog = pdf_new_object(pdf);
+	report->outlines = pdf_new_object(pdf);
+	report->pages = pdf_new_object(pdf);
+	report->procset = pdf_new_object(pdf);
+	report->font = pdf_new_object(pdf);
+	report->encoding = pdf_new_object(pdf);
+	report->info = pdf_new_object(pdf);
+	report->uri[0] = pdf_new_object(pdf);
+	report->uri[1] = pdf_new_object(pdf);
+	report->rose = pdf_new_object(pdf);
+
+	pdf_begin_object(pdf, report->catalog);
+	pdf_puts(pdf, "   << /Type /Catalog\n");
+	pdf_printf(pdf, "      /Outlines %u 0 R\n", report->outlines);
+	pdf_printf(pdf, "      /Pages %u 0 R\n", report->pages);
+	pdf_puts(pdf, "   >>\n");
+	pdf_end_object(pdf);
+
+	pdf_begin_object(pdf, report->outlines);
+	pdf_puts(pdf, "   << /Type /Outlines\n");
+	pdf_puts(pdf, "      /Count 0\n");
+	pdf_puts(pdf, "   >>\n");
+	pdf_end_object(pdf);
+
+	pdf_begin_object(pdf, report->uri[0]);
+	pdf_puts(pdf, "   << /S /URI\n");
+	pdf_puts(pdf, "      /URI (mailto:ecd@brainaid.de)\n");
+	pdf_puts(pdf, "   >>\n");
+	pdf_end_object(pdf);
+
+	pdf_begin_object(pdf, report->uri[1]);
+	pdf_puts(pdf, "   << /S /URI\n");
+	pdf_puts(pdf, "      /URI (http://brainaid.de/people/ecd/radarplot/)\n");
+	pdf_puts(pdf, "   >>\n");
+	pdf_end_object(pdf);
+
+	if (pdf_report_rose(report) < 0) {
+		pdf_report_abort(report);
+		return -1;
+	}
 
-			if (color)
-				stream += output_gc_rgb_color(file, vect->gc);
+	return 0;
+}
 
-			gdk_gc_get_values(vect->gc, &values);
+static int
+pdf_report_page(pdf_report_t *report, pdf_snapshot_t *snap)
+{
+	unsigned int page, content, annot[2], annots;
+	pdf_rect_t annot_rect[2];
+	double step, fs, x, y, w, h, r, lw, xoff, yoff;
+	double nw, nh, sw, xoffset, yoffset, width;
+	unsigned char text[32];
+	afm_extents_t extents;
+	pdf_item_t *item;
+	pdf_t *pdf = report->pdf;
+	afm_t *afm = report->afm;
+	int color = report->color;
+	int i, k, a;
+
+	w = report->w;
+	h = report->h;
+	fs = report->fs;
+	lw = report->lw;
+	step = report->step;
+	nw = report->nw;
+	nh = report->nh;
+
+	page = pdf_new_object(pdf);
+	content = pdf_new_object(pdf);
+	annot[0] = pdf_new_object(pdf);
+	annot[1] = pdf_new_object(pdf);
+	annots = pdf_new_object(pdf);
+
+	pdf_begin_object(pdf, page);
+	pdf_puts(pdf, "   << /Type /Page\n");
+	pdf_printf(pdf, "      /MediaBox [ 0 0 %u %u ]\n",
+		   report->paper_width, report->paper_height);
+	pdf_printf(pdf, "      /CropBox [ 0 0 %u %u ]\n",
+		   report->paper_width, report->paper_height);
+	pdf_puts(pdf, "      /Rotate   0\n");
+	pdf_printf(pdf, "      /Parent %u 0 R\n", report->pages);
+	pdf_printf(pdf, "      /Contents %u 0 R\n", content);
+	pdf_printf(pdf, "      /Annots %u 0 R\n", annots);
+	pdf_puts(pdf, "      /Resources\n");
+	pdf_printf(pdf, "         << /ProcSet %u 0 R\n", report->procset);
+	pdf_puts(pdf, "            /Font\n");
+	pdf_printf(pdf, "               << /%s %u 0 R >>\n",
+		   afm->pdf_name, report->font);
+	pdf_puts(pdf, "            /XObject\n");
+	pdf_printf(pdf, "               << /Rose %u 0 R >>\n", report->rose);
+	pdf_puts(pdf, "         >>\n");
+	pdf_puts(pdf, "   >>\n");
+	pdf_end_object(pdf);
+
+
+	pdf_begin_stream(pdf);
+	pdf_op(pdf, "q");
+	pdf_concat(pdf, 72.0 / 25.4, 0.0, 0.0, 72.0 / 25.4, 0.0, 0.0);
 
-			if (values.line_width == 0)
-				stream += fprintf(file, "%.3f w\n",
-						  color ? lw : 2.0 * lw);
-			else
-				stream += fprintf(file, "%.3f w\n", (double)
-						  values.line_width * lw);
+	xoffset = 6.0 * step + nw + nh / 2.0 + 10.0;
+	yoffset = h - (6.0 * step + nh + nh / 2.0 + 10.0);
 
-			if (values.line_style == GDK_LINE_ON_OFF_DASH)
-				stream += fprintf(file, "[1 1] 0 d\n");
+	pdf_translate(pdf, xoffset, yoffset);
 
-			translate_point(vect->x1, vect->y1,
-					radar->cx, radar->cy, radar->r,
-					0.0, 0.0, 6.0 * step, &x, &y);
-			stream += fprintf(file, "%.3f %.3f m\n", x, -y);
+	pdf_op1(pdf, lw / 2.0, "w");	/* lineWidth */
+	pdf_op(pdf, "1 J");		/* lineCap: Round */
+	pdf_op(pdf, "1 j");		/* lineJoin: Round */
 
-			translate_point(vect->x2, vect->y2,
-					radar->cx, radar->cy, radar->r,
-					0.0, 0.0, 6.0 * step, &x, &y);
-			stream += fprintf(file, "%.3f %.3f l\n", x, -y);
 
-			stream += fprintf(file, "S\n");
+	if (!snap->licensed) {
+		pdf_op(pdf, "q");
 
-			if (values.line_style == GDK_LINE_ON_OFF_DASH)
-				stream += fprintf(file, "[] 0 d\n");
-		}
+		/* calculate extents, calculate scale from that. */
+		afm_text_extents(afm, 7.0 * fs, report->strings->unregistered,
+				 strlen(report->strings->unregistered),
+				 &extents);
+
+		/* rotate */
+		pdf_concat(pdf, cos(M_PI/4.0), sin(M_PI/4.0),
+			   -sin(M_PI/4.0), cos(M_PI/4.0), 0.0, 0.0);
 
-		for (j = 0; j < TARGET_NR_ARCS; j++) {
-			arc = &target->arcs[j];
+		/* translate */
+		x = -extents.width / 2.0;
+		y = -extents.ascent / 2.0;
 
-			if (!arc->is_visible)
-				continue;
+		pdf_translate(pdf, x, y);
+
+		/* 25% grey */
+		pdf_op1(pdf, 0.75, "g");
 
-			if (color)
-				stream += output_gc_rgb_color(file, arc->gc);
+		afm_print_text(pdf, afm, 7.0 * fs, 0.0, 0.0,
+			       report->strings->unregistered,
+			       strlen(report->strings->unregistered));
+
+		pdf_op(pdf, "Q");
+	}
+
+
+	pdf_translate(pdf, -xoffset, -yoffset);
+	pdf_op(pdf, "/Rose Do");
+	pdf_translate(pdf, xoffset, yoffset);
 
-			gdk_gc_get_values(arc->gc, &values);
 
-			if (values.line_width == 0)
-				stream += fprintf(file, "%.3f w\n",
-						  color ? lw : 2.0 * lw);
+	pdf_op(pdf, "0.5 w");
+
+	for (a = 0; a < 360; a += 90) {
+
+		for (i = 1; i < 6; i++) {
+			if (snap->marks == 3) {
+				if (i % 2)
+					continue;
+			}
+
+			if (snap->range > 3.0)
+				sprintf((char *) text, "%u", (unsigned int)
+					((double) i * snap->range) / 6);
 			else
-				stream += fprintf(file, "%.3f w\n", (double)
-						  values.line_width * lw);
+				sprintf((char *) text, "%.*f", snap->digits,
+					(double) i * snap->range / 6.0);
 
-			translate_point(arc->x, arc->y,
-					radar->cx, radar->cy, radar->r,
-					0.0, 0.0, 6.0 * step, &x, &y);
-			translate_length(arc->radius, radar->r,
-					 6.0 * step, &r);
+			r = step * (double) i;
 
-			stream += output_arc(file, x, -y, r,
-					     arc->angle1, arc->angle2);
-		}
+			x = r * sin(M_PI * (double) a / 180.0);
+			y = r * cos(M_PI * (double) a / 180.0);
 
-		for (j = 0; j < TARGET_NR_POLYS; j++) {
-			poly = &target->polys[j];
+			afm_text_extents(afm, fs, (char *) text,
+					 strlen((char *) text), &extents);
 
-			if (!poly->is_visible)
-				continue;
+			x -= extents.bbox.llx +
+				(extents.bbox.urx - extents.bbox.llx) / 2.0;
+			y -= extents.ascent / 2.0;
 
-			if (color)
-				stream += output_gc_rgb_color(file, poly->gc);
+			pdf_op(pdf, "1 g");
+			pdf_op(pdf, "1 G");
+			pdf_op2(pdf, x + extents.bbox.llx,
+				y + extents.bbox.lly, "m");
+			pdf_op2(pdf, x + extents.bbox.urx,
+				y + extents.bbox.lly, "l");
+			pdf_op2(pdf, x + extents.bbox.urx,
+				y + extents.bbox.ury, "l");
+			pdf_op2(pdf, x + extents.bbox.llx,
+				y + extents.bbox.ury, "l");
+			pdf_op(pdf, "b");
+			pdf_op(pdf, "0 g");
+			pdf_op(pdf, "0 G");
+			afm_print_text(pdf, afm, fs, x, y,
+				       (char *) text,
+				       strlen((char *) text));
+		}
+	}
+
+	for (i = 0; i < snap->items->len; i++) {
+		item = &g_array_index(snap->items, pdf_item_t, i);
 
-			gdk_gc_get_values(poly->gc, &values);
+		if (color)
+			output_rgb_color(pdf, item->rgb);
 
-			if (values.line_width == 0)
-				stream += fprintf(file, "%.3f w\n",
-						  color ? lw : 2.0 * lw);
+		if (item->type != DISPLAY_LABEL) {
+			if (item->line_width)
+				width = (double) item->line_width * lw;
+			else if (item->is_target && !color)
+				width = 2.0 * lw;
 			else
-				stream += fprintf(file, "%.3f w\n", (double)
-						  values.line_width * lw);
+				width = lw;
 
-			translate_point(poly->points[0].x, poly->points[0].y,
-					radar->cx, radar->cy, radar->r,
+			pdf_op1(pdf, width, "w");
+		}
+
+		switch (item->type) {
+		case DISPLAY_VECTOR:
+			if (item->line_style == GDK_LINE_ON_OFF_DASH)
+				pdf_op(pdf, "[1 1] 0 d");
+
+			translate_point(item->points[0].x, item->points[0].y,
+					snap->cx, snap->cy, snap->r,
 					0.0, 0.0, 6.0 * step, &x, &y);
-			stream += fprintf(file, "%.3f %.3f m\n", x, -y);
-			for (k = 1; k < poly->npoints; k++) {
-				translate_point(poly->points[k].x,
-						poly->points[k].y,
-						radar->cx, radar->cy, radar->r,
-						0.0, 0.0, 6.0 * step, &x, &y);
-				stream += fprintf(file, "%.3f %.3f l\n", x, -y);
-			}
+			pdf_op2(pdf, x, -y, "m");
 
-			stream += fprintf(file, "h f\n");
-		}
+			translate_point(item->points[1].x, item->points[1].y,
+					snap->cx, snap->cy, snap->r,
+					0.0, 0.0, 6.0 * step, &x, &y);
+			pdf_op2(pdf, x, -y, "l");
 
-		for (j = 0; j < TARGET_NR_LABELS; j++) {
-			label = &target->labels[j];
+			pdf_op(pdf, "S");
 
-			if (!label->is_visible)
-				continue;
+			if (item->line_style == GDK_LINE_ON_OFF_DASH)
+				pdf_op(pdf, "[] 0 d");
+			break;
+
+		case DISPLAY_ARC:
+			translate_point(item->points[0].x, item->points[0].y,
+					snap->cx, snap->cy, snap->r,
+					0.0, 0.0, 6.0 * step, &x, &y);
+			translate_length(item->radius, snap->r,
+					 6.0 * step, &r);
+
+			output_arc(pdf, x, -y, r,
+				   item->angle1, item->angle2);
+			break;
 
-			if (color)
-				stream += output_gc_rgb_color(file, label->fg);
+		case DISPLAY_POLY:
+			translate_point(item->points[0].x, item->points[0].y,
+					snap->cx, snap->cy, snap->r,
+					0.0, 0.0, 6.0 * step, &x, &y);
+			pdf_op2(pdf, x, -y, "m");
+			for (k = 1; k < item->npoints; k++) {
+				translate_point(item->points[k].x,
+						item->points[k].y,
+						snap->cx, snap->cy, snap->r,
+						0.0, 0.0, 6.0 * step, &x, &y);
+				pdf_op2(pdf, x, -y, "l");
+			}
 
-			translate_point(label->cx, label->cy,
-					radar->cx, radar->cy, radar->r,
+			pdf_op(pdf, "h f");
+			break;
+
+		case DISPLAY_LABEL:
+			translate_point(item->points[0].x, item->points[0].y,
+					snap->cx, snap->cy, snap->r,
 					0.0, 0.0, 6.0 * step, &x, &y);
 
-			translate_length(label->xoff, radar->r, 6.0 * step,
+			translate_length(item->xoff, snap->r, 6.0 * step,
 					 &xoff);
-			translate_length(label->yoff, radar->r, 6.0 * step,
+			translate_length(item->yoff, snap->r, 6.0 * step,
 					 &yoff);
 
-			afm_text_extents(afm, 1.5 * fs, label->markup,
-					 strlen(label->markup), &extents);
+			afm_text_extents(afm, 1.5 * fs, item->markup,
+					 strlen(item->markup), &extents);
 
 #ifdef DEBUG_LABEL_ALIGN
-			stream += pdf_output_align(file, x + xoff, -y - yoff);
+			pdf_output_align(pdf, x + xoff, -y - yoff);
 #endif
 
-			pdf_label_align(label->xalign, label->yalign,
+			pdf_label_align(item->xalign, item->yalign,
 					&extents, &xoff, &yoff);
 
 #ifdef DEBUG_LABEL_ALIGN
-			stream += pdf_output_bbox(file, x + xoff, -y - yoff,
-						  &extents);
+			pdf_output_bbox(pdf, x + xoff, -y - yoff,
+					&extents);
 #endif
 
-			stream += afm_print_text(file, afm, 1.5 * fs,
-						 x + xoff, -y - yoff,
-						 label->markup,
-						 strlen(label->markup));
+			afm_print_text(pdf, afm, 1.5 * fs,
+				       x + xoff, -y - yoff,
+				       item->markup,
+				       strlen(item->markup));
+			break;
 		}
 	}
 
-	stream += fprintf(file, "1 0 0 1 %.3f %.3f cm\n", -xoffset, -yoffset);
+	pdf_translate(pdf, -xoffset, -yoffset);
 
 	xoffset -= 6.0 * step;
 	yoffset = 10.0 + fs + 2.0 * nh + step / 3.0;
 	sw = 12.0 * step;
 
-	stream += fprintf(file, "1 0 0 1 %.3f %.3f cm\n", xoffset, yoffset);
-
-	stream += output_linear_scale(file, afm, 0.75 * fs, lw,
-				      sw, step / 6.0, 0.0, 2.0 * radar->range);
+	pdf_translate(pdf, xoffset, yoffset);
 
-	stream += fprintf(file, "1 0 0 1 %.3f %.3f cm\n", -xoffset, -yoffset);
+	output_linear_scale(pdf, afm, report->strings->scale[0], 0.75 * fs,
+			    lw, sw, step / 6.0, 0.0, 2.0 * snap->range);
 
-	yoffset = 10.0 + nh + step / 24.0;
-	sw = w - xoffset - 10.0;
-
-	stream += fprintf(file, "1 0 0 1 %.3f %.3f cm\n", xoffset, yoffset);
-
-	stream += output_log_scale(file, afm, 0.75 * fs, lw,
-				   sw, step / 6.0, 0.1, 60.0);
-
-	stream += fprintf(file, "1 0 0 1 %.3f %.3f cm\n", -xoffset, -yoffset);
+	pdf_translate(pdf, -xoffset, -yoffset);
 
 	xoffset = 12.0 * step + 3.0 * nw + nh + 10.0;
 	yoffset = 10.0 + fs + 2.0 * nh + step / 3.0;
 
-	stream += fprintf(file, "1 0 0 1 %.3f %.3f cm\n", xoffset, yoffset);
+	pdf_translate(pdf, xoffset, yoffset);
 
-	stream += output_table(radar, file, afm, fs, lw,
-			       w - xoffset - 10.0, h - yoffset - 10.0,
-			       annot_rect);
+	output_table(snap, report->strings, pdf, afm, fs, lw,
+		     w - xoffset - 10.0, h - yoffset - 10.0,
+		     annot_rect);
 
 	annot_rect[0].llx += xoffset;
 	annot_rect[0].urx += xoffset;
@@ -2965,74 +3174,93 @@ radar_print_as_PDF(radar_t *radar, const char *filename,
 	annot_rect[1].lly *= 72.0 / 25.4;
 	annot_rect[1].ury *= 72.0 / 25.4;
 
-	stream += fprintf(file, "1 0 0 1 %.3f %.3f cm\n", -xoffset, -yoffset);
+	pdf_translate(pdf, -xoffset, -yoffset);
 
-	if (radar_ranges[radar->rindex].digits)
-		sprintf((char *) text, _("%.*f nm"),
-			radar_ranges[radar->rindex].digits,
-			radar->range);
-	else
-		sprintf((char *) text, _("%.1f nm"), radar->range);
+	afm_text_extents(afm, 3.0 * fs, snap->range_text,
+			 strlen(snap->range_text), &extents);
+	afm_print_text(pdf, afm, 3.0 * fs,
+		       10.0 - extents.bbox.llx,
+		       h - 10.0 - extents.ascent,
+		       snap->range_text, strlen(snap->range_text));
 
-	afm_text_extents(afm, 3.0 * fs, (char *) text,
-			 strlen((char *) text), &extents);
-	stream += afm_print_text(file, afm, 3.0 * fs,
-				 10.0 - extents.bbox.llx,
-				 h - 10.0 - extents.ascent,
-				 (char *) text, strlen((char *) text));
-
-	stream += fprintf(file, "Q\n");
-
-	offset += stream;
-	offset += fprintf(file, "endstream\n");
-	offset += fprintf(file, "endobj\n");
-	offset += fprintf(file, "\n");
-
-	length = offset;
-	offset += fprintf(file, "6 0 obj\n");
-	offset += fprintf(file, "   %u\n", stream);
-	offset += fprintf(file, "endobj\n");
-	offset += fprintf(file, "\n");
-
-	procset = offset;
-	offset += fprintf(file, "7 0 obj\n");
-	offset += fprintf(file, "   [ /PDF /Text ]\n");
-	offset += fprintf(file, "endobj\n");
-	offset += fprintf(file, "\n");
-
-	font = offset;
-	offset += fprintf(file, "8 0 obj\n");
-	offset += fprintf(file, "   << /Type /Font\n");
-	offset += fprintf(file, "      /Subtype /Type1\n");
-	offset += fprintf(file, "      /Name /%s\n", afm->pdf_name);
-	offset += fprintf(file, "      /BaseFont /%s\n", afm->font_name);
-	offset += fprintf(file, "      /Encoding 9 0 R\n");
-	offset += fprintf(file, "   >>\n");
-	offset += fprintf(file, "endobj\n");
-	offset += fprintf(file, "\n");
-
-	encoding = offset;
-	offset += fprintf(file, "9 0 obj\n");
-	offset += fprintf(file, "   << /Type /Encoding\n");
-	offset += fprintf(file, "      /Differences\n");
-	offset += fprintf(file, "         [\n");
+	pdf_op(pdf, "Q");
+
+	if (pdf_end_stream(pdf, content, NULL) < 0)
+		return -1;
+
+	for (i = 0; i < 2; i++) {
+		pdf_begin_object(pdf, annot[i]);
+		pdf_puts(pdf, "   << /Type /Annot\n");
+		pdf_puts(pdf, "      /Subtype /Link\n");
+		pdf_puts(pdf, "      /Border [0 0 0]\n");
+		pdf_printf(pdf, "      /Rect [%.4f %.4f %.4f %.4f]\n",
+			   annot_rect[i].llx, annot_rect[i].lly,
+			   annot_rect[i].urx, annot_rect[i].ury);
+		pdf_puts(pdf, "      /BS << /Type /Border /S /S /W 0 >>\n");
+		pdf_printf(pdf, "      /A %u 0 R\n", report->uri[i]);
+		pdf_puts(pdf, "   >>\n");
+		pdf_end_object(pdf);
+	}
+
+	pdf_begin_object(pdf, annots);
+	pdf_printf(pdf, "   [ %u 0 R %u 0 R ]\n", annot[0], annot[1]);
+	pdf_end_object(pdf);
+
+	g_array_append_val(report->kids, page);
+
+	return pdf_flush(pdf);
+}
+
+G_LOCK_DEFINE_STATIC(pdf_time);
+
+static int
+pdf_report_end(pdf_report_t *report)
+{
+	static const char *source_date = "$Date: 2009-07-24 11:37:17 $";
+	const char *filename = report->filename;
+	struct tm tm0, tm1;
+	time_t t, tz;
+	const char *p;
+	pdf_t *pdf = report->pdf;
+	afm_t *afm = report->afm;
+	int i, ret;
+
+	pdf_begin_object(pdf, report->procset);
+	pdf_puts(pdf, "   [ /PDF /Text ]\n");
+	pdf_end_object(pdf);
+
+	pdf_begin_object(pdf, report->font);
+	pdf_puts(pdf, "   << /Type /Font\n");
+	pdf_puts(pdf, "      /Subtype /Type1\n");
+	pdf_printf(pdf, "      /Name /%s\n", afm->pdf_name);
+	pdf_printf(pdf, "      /BaseFont /%s\n", afm->font_name);
+	pdf_printf(pdf, "      /Encoding %u 0 R\n", report->encoding);
+	pdf_puts(pdf, "   >>\n");
+	pdf_end_object(pdf);
+
+	pdf_begin_object(pdf, report->encoding);
+	pdf_puts(pdf, "   << /Type /Encoding\n");
+	pdf_puts(pdf, "      /Differences\n");
+	pdf_puts(pdf, "         [\n");
 	for (i = 0; i < 256; i++) {
 		if (NULL == afm->char_table[i].ch)
 			continue;
-		offset += fprintf(file, "            %3u /%s\n",
-				  i, afm->char_table[i].ch->name);
+		pdf_printf(pdf, "            %3u /%s\n",
+			   i, afm->char_table[i].ch->name);
 	}
-	offset += fprintf(file, "         ]\n");
-	offset += fprintf(file, "   >>\n");
-	offset += fprintf(file, "endobj\n");
-	offset += fprintf(file, "\n");
+	pdf_puts(pdf, "         ]\n");
+	pdf_puts(pdf, "   >>\n");
+	pdf_end_object(pdf);
 
 	t = time(NULL);
 
-	tm0 = localtime(&t);
-	tm1 = gmtime(&t);
+	/* localtime() and gmtime() share one static buffer */
+	G_LOCK(pdf_time);
+	tm0 = *localtime(&t);
+	tm1 = *gmtime(&t);
+	G_UNLOCK(pdf_time);
 
-	tz = mktime(tm0) - mktime(tm1);
+	tz = mktime(&tm0) - mktime(&tm1);
 
 	if ((p = strrchr(filename, '/')))
 		p++;
@@ -3041,120 +3269,358 @@ radar_print_as_PDF(radar_t *radar, const char *filename,
 	else
 		p = filename;
 
-	info = offset;
-	offset += fprintf(file, "10 0 obj\n");
-	offset += fprintf(file, "   << /Type /Info\n");
-	offset += fprintf(file, "      /Title (Radarplot - %s)\n", p);
-	offset += fprintf(file, "      /Author (Christian Dost <ecd@brainaid.de>)\n");
-	offset += fprintf(file, "      /Subject (Radarplot)\n");
-	offset += fprintf(file, "      /Keywords (Radarplot)\n");
-	offset += fprintf(file, "      /Creator (brainaid Radarplot %u.%u.%u)\n",
-			  RADAR_MAJOR, RADAR_MINOR, RADAR_PATCHLEVEL);
-	offset += fprintf(file, "      /Producer (brainaid Radarplot %u.%u.%u)\n",
-			  RADAR_MAJOR, RADAR_MINOR, RADAR_PATCHLEVEL);
-	offset += fprintf(file, "      /Company (brainaid GbR)\n");
-	offset += fprintf(file, "      /SourceModified (%.4s%.2s%.2s%.2s%.2s%.2s)\n",
-			  &source_date[7], &source_date[12],
-			  &source_date[15], &source_date[18],
-			  &source_date[21], &source_date[24]);
-	offset += fprintf(file, "      /CreationDate (D:%04u%02u%02u%02u%02u%02u%c%02u'00')\n",
-			  tm0->tm_year + 1900, tm0->tm_mon + 1, tm0->tm_mday,
-			  tm0->tm_hour, tm0->tm_min, tm0->tm_sec,
-			  tz < 0 ? '-' : '+', abs(tz) / 3600);
-	offset += fprintf(file, "      /ModDate (D:%04u%02u%02u%02u%02u%02u%c%02u'00')\n",
-			  tm0->tm_year + 1900, tm0->tm_mon + 1, tm0->tm_mday,
-			  tm0->tm_hour, tm0->tm_min, tm0->tm_sec,
-			  tz < 0 ? '-' : '+', abs(tz) / 3600);
-	offset += fprintf(file, "   >>\n");
-	offset += fprintf(file, "endobj\n");
-	offset += fprintf(file, "\n");
-
-	uri[0] = offset;
-	offset += fprintf(file, "11 0 obj\n");
-	offset += fprintf(file, "   << /S /URI\n");
-	offset += fprintf(file, "      /URI (mailto:ecd@brainaid.de)\n");
-	offset += fprintf(file, "   >>\n");
-	offset += fprintf(file, "endobj\n");
-	offset += fprintf(file, "\n");
-
-	uri[1] = offset;
-	offset += fprintf(file, "12 0 obj\n");
-	offset += fprintf(file, "   << /S /URI\n");
-	offset += fprintf(file, "      /URI (http://brainaid.de/people/ecd/radarplot/)\n");
-	offset += fprintf(file, "   >>\n");
-	offset += fprintf(file, "endobj\n");
-	offset += fprintf(file, "\n");
-
-	annot[0] = offset;
-	offset += fprintf(file, "13 0 obj\n");
-	offset += fprintf(file, "   << /Type /Annot\n");
-	offset += fprintf(file, "      /Subtype /Link\n");
-	offset += fprintf(file, "      /Border [0 0 0]\n");
-	offset += fprintf(file, "      /Rect [%.4f %.4f %.4f %.4f]\n",
-			  annot_rect[0].llx, annot_rect[0].lly,
-			  annot_rect[0].urx, annot_rect[0].ury);
-	offset += fprintf(file, "      /BS << /Type /Border /S /S /W 0 >>\n");
-	offset += fprintf(file, "      /A 11 0 R\n");
-	offset += fprintf(file, "   >>\n");
-	offset += fprintf(file, "endobj\n");
-	offset += fprintf(file, "\n");
-
-	annot[1] = offset;
-	offset += fprintf(file, "14 0 obj\n");
-	offset += fprintf(file, "   << /Type /Annot\n");
-	offset += fprintf(file, "      /Subtype /Link\n");
-	offset += fprintf(file, "      /Border [0 0 0]\n");
-	offset += fprintf(file, "      /Rect [%.4f %.4f %.4f %.4f]\n",
-			  annot_rect[1].llx, annot_rect[1].lly,
-			  annot_rect[1].urx, annot_rect[1].ury);
-	offset += fprintf(file, "      /BS << /Type /Border /S /S /W 0 >>\n");
-	offset += fprintf(file, "      /A 12 0 R\n");
-	offset += fprintf(file, "   >>\n");
-	offset += fprintf(file, "endobj\n");
-	offset += fprintf(file, "\n");
-
-	annots = offset;
-	offset += fprintf(file, "15 0 obj\n");
-	offset += fprintf(file, "   [ 13 0 R 14 0 R ]\n");
-	offset += fprintf(file, "endobj\n");
-	offset += fprintf(file, "\n");
-
-	xref = offset;
-	offset += fprintf(file, "xref\n");
-	offset += fprintf(file, "0 16\n");
-	offset += fprintf(file, "%010u %05u f \n", 0, 65535);
-	offset += fprintf(file, "%010u %05u n \n", catalog, 0);
-	offset += fprintf(file, "%010u %05u n \n", outlines, 0);
-	offset += fprintf(file, "%010u %05u n \n", pages, 0);
-	offset += fprintf(file, "%010u %05u n \n", page, 0);
-	offset += fprintf(file, "%010u %05u n \n", content, 0);
-	offset += fprintf(file, "%010u %05u n \n", length, 0);
-	offset += fprintf(file, "%010u %05u n \n", procset, 0);
-	offset += fprintf(file, "%010u %05u n \n", font, 0);
-	offset += fprintf(file, "%010u %05u n \n", encoding, 0);
-	offset += fprintf(file, "%010u %05u n \n", info, 0);
-	offset += fprintf(file, "%010u %05u n \n", uri[0], 0);
-	offset += fprintf(file, "%010u %05u n \n", uri[1], 0);
-	offset += fprintf(file, "%010u %05u n \n", annot[0], 0);
-	offset += fprintf(file, "%010u %05u n \n", annot[1], 0);
-	offset += fprintf(file, "%010u %05u n \n", annots, 0);
-	offset += fprintf(file, "\n");
-
-	offset += fprintf(file, "trailer\n");
-	offset += fprintf(file, "   << /Size 16\n");
-	offset += fprintf(file, "      /Root 1 0 R\n");
-	offset += fprintf(file, "      /Info 10 0 R\n");
-	offset += fprintf(file, "   >>\n");
-	offset += fprintf(file, "\n");
-
-	offset += fprintf(file, "startxref\n");
-	offset += fprintf(file, "%u\n", xref);
-	offset += fprintf(file, "%%%%EOF\n");
-
-	fclose(file);
-
-	afm_free(afm);
-	return 0;
+	pdf_begin_object(pdf, report->info);
+	pdf_puts(pdf, "   << /Type /Info\n");
+	pdf_printf(pdf, "      /Title (Radarplot - %s)\n", p);
+	pdf_puts(pdf, "      /Author (Christian Dost <ecd@brainaid.de>)\n");
+	pdf_puts(pdf, "      /Subject (Radarplot)\n");
+	pdf_puts(pdf, "      /Keywords (Radarplot)\n");
+	pdf_printf(pdf, "      /Creator (brainaid Radarplot %u.%u.%u)\n",
+		   RADAR_MAJOR, RADAR_MINOR, RADAR_PATCHLEVEL);
+	pdf_printf(pdf, "      /Producer (brainaid Radarplot %u.%u.%u)\n",
+		   RADAR_MAJOR, RADAR_MINOR, RADAR_PATCHLEVEL);
+	pdf_puts(pdf, "      /Company (brainaid GbR)\n");
+	pdf_printf(pdf, "      /SourceModified (%.4s%.2s%.2s%.2s%.2s%.2s)\n",
+		   &source_date[7], &source_date[12],
+		   &source_date[15], &source_date[18],
+		   &source_date[21], &source_date[24]);
+	pdf_printf(pdf, "      /CreationDate (D:%04u%02u%02u%02u%02u%02u%c%02u'00')\n",
+		   tm0.tm_year + 1900, tm0.tm_mon + 1, tm0.tm_mday,
+		   tm0.tm_hour, tm0.tm_min, tm0.tm_sec,
+		   tz < 0 ? '-' : '+', abs(tz) / 3600);
+	pdf_printf(pdf, "      /ModDate (D:%04u%02u%02u%02u%02u%02u%c%02u'00')\n",
+		   tm0.tm_year + 1900, tm0.tm_mon + 1, tm0.tm_mday,
+		   tm0.tm_hour, tm0.tm_min, tm0.tm_sec,
+		   tz < 0 ? '-' : '+', abs(tz) / 3600);
+	pdf_puts(pdf, "   >>\n");
+	pdf_end_object(pdf);
+
+	pdf_begin_object(pdf, report->pages);
+	pdf_puts(pdf, "   << /Type /Pages\n");
+	pdf_puts(pdf, "      /Kids [\n");
+	for (i = 0; i < report->kids->len; i++)
+		pdf_printf(pdf, "         %u 0 R\n",
+			   g_array_index(report->kids, unsigned int, i));
+	pdf_puts(pdf, "      ]\n");
+	pdf_printf(pdf, "      /Count %u\n", report->kids->len);
+	pdf_puts(pdf, "   >>\n");
+	pdf_end_object(pdf);
+
+	pdf_finish(pdf, report->catalog, report->info);
+
+	ret = pdf_close(pdf);
+
+	g_array_free(report->kids, TRUE);
+	return ret;
+}
+
+int
+radar_print_as_PDF(radar_t *radar, const char *filename,
+		   const char *paper, int color)
+{
+	pdf_strings_t *strings;
+	pdf_snapshot_t *snap;
+	pdf_report_t report;
+	int ret;
+#ifdef DEBUG_PDF_TIME
+	GTimer *timer = g_timer_new();
+#endif
+
+	strings = pdf_strings_new();
+
+	if (pdf_report_begin(&report, strings, filename, paper, color) < 0) {
+		ret = -1;
+		goto out;
+	}
+
+	snap = pdf_snapshot_new(radar);
+	ret = pdf_report_page(&report, snap);
+	pdf_snapshot_free(snap);
+
+	if (ret < 0) {
+		pdf_report_abort(&report);
+		goto out;
+	}
+
+#ifdef DEBUG_PDF_TIME
+	printf("%s: %lu bytes in %.3f ms\n", __FUNCTION__,
+	       (unsigned long) report.pdf->flushed,
+	       1000.0 * g_timer_elapsed(timer, NULL));
+	g_timer_destroy(timer);
+#endif
+
+	ret = pdf_report_end(&report);
+
+out:
+	pdf_strings_free(strings);
+	return ret;
+}
+
+/*
+ * Put the scenario on screen aside while plot files are loaded into
+ * 'radar', see pdf_restore_current().
+ */
+static char *
+pdf_save_current(radar_t *radar)
+{
+	GError *error = NULL;
+	char *current;
+	int fd;
+
+	fd = g_file_open_tmp("radarplot-XXXXXX.rpt", &current, &error);
+	if (fd < 0) {
+		fprintf(stderr, "%s:%u: tmpfile: %s\n",
+			__FUNCTION__, __LINE__, error->message);
+		g_error_free(error);
+		return NULL;
+	}
+	close(fd);
+
+	if (radar_save(radar, current) < 0) {
+		g_unlink(current);
+		g_free(current);
+		return NULL;
+	}
+
+	return current;
+}
+
+static void
+pdf_restore_current(radar_t *radar, char *current)
+{
+	radar_load(radar, current);
+	g_unlink(current);
+	g_free(current);
+}
+
+/*
+ * One page per plot file.  The plots are loaded into 'radar' in turn,
+ * the scenario on screen is put back afterwards.
+ */
+int
+radar_print_report_as_PDF(radar_t *radar, const char *filename,
+			  const char *paper, int color, GSList *plots)
+{
+	pdf_strings_t *strings;
+	pdf_snapshot_t *snap;
+	pdf_report_t report;
+	char *current;
+	GSList *l;
+	int ret = 0;
+
+	current = pdf_save_current(radar);
+	if (NULL == current)
+		return -1;
+
+	strings = pdf_strings_new();
+
+	if (pdf_report_begin(&report, strings, filename, paper, color) < 0) {
+		ret = -1;
+		goto out;
+	}
+
+	for (l = plots; l; l = l->next) {
+		if (radar_load(radar, l->data) < 0) {
+			fprintf(stderr, "%s:%u: skipping '%s'\n",
+				__FUNCTION__, __LINE__, (char *) l->data);
+			continue;
+		}
+
+		snap = pdf_snapshot_new(radar);
+		ret = pdf_report_page(&report, snap);
+		pdf_snapshot_free(snap);
+
+		if (ret < 0) {
+			pdf_report_abort(&report);
+			goto out;
+		}
+	}
+
+	/* no page at all, rather no file than an empty one */
+	if (0 == report.kids->len) {
+		fprintf(stderr, "%s:%u: no plot loaded, '%s' not written\n",
+			__FUNCTION__, __LINE__, filename);
+		pdf_report_abort(&report);
+		ret = -1;
+		goto out;
+	}
+
+	ret = pdf_report_end(&report);
+
+out:
+	pdf_strings_free(strings);
+	pdf_restore_current(radar, current);
+	return ret;
+}
+
+typedef struct {
+	pdf_strings_t	*strings;	/* shared by all jobs */
+	pdf_snapshot_t	*snap;
+	char		*filename;
+	const char	*paper;
+	int		color;
+	int		ret;
+} pdf_job_t;
+
+static void
+pdf_job_func(gpointer data, gpointer user_data)
+{
+	pdf_job_t *job = data;
+	pdf_report_t report;
+
+	job->ret = pdf_report_begin(&report, job->strings, job->filename,
+				    job->paper, job->color);
+	if (job->ret < 0)
+		goto out;
+
+	job->ret = pdf_report_page(&report, job->snap);
+	if (job->ret < 0) {
+		pdf_report_abort(&report);
+		goto out;
+	}
+
+	job->ret = pdf_report_end(&report);
+
+out:
+	pdf_snapshot_free(job->snap);
+	job->snap = NULL;
+}
+
+/*
+ * Output file in 'folder' for each plot, named after the plot with
+ * ".pdf".  Plots that would get the same name, from different folders
+ * or differing only in extension or case, get "-2", "-3", ... added,
+ * so no two jobs write the same file.
+ */
+static char **
+pdf_plot_filenames(const char *folder, GSList *plots)
+{
+	GHashTable *taken;
+	char **filenames;
+	char *name, *base, *key, *p;
+	GSList *l;
+	int i, n;
+
+	taken = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	filenames = g_new0(char *, g_slist_length(plots) + 1);
+
+	for (l = plots, i = 0; l; l = l->next, i++) {
+		name = g_path_get_basename(l->data);
+		p = strrchr(name, '.');
+		if (p)
+			*p = '\0';
+
+		base = g_strdup_printf("%s.pdf", name);
+		key = g_ascii_strdown(base, -1);
+		for (n = 2; g_hash_table_lookup(taken, key); n++) {
+			g_free(key);
+			g_free(base);
+			base = g_strdup_printf("%s-%d.pdf", name, n);
+			key = g_ascii_strdown(base, -1);
+		}
+		g_hash_table_insert(taken, key, key);
+
+		filenames[i] = g_strdup_printf("%s%s%s", folder,
+					       G_DIR_SEPARATOR_S, base);
+		g_free(base);
+		g_free(name);
+	}
+
+	g_hash_table_destroy(taken);
+	return filenames;
+}
+
+/*
+ * One PDF file per plot, named after the plot with ".pdf" in 'folder'.
+ * Loading a plot and taking its snapshot needs the GTK thread, the
+ * files are written meanwhile by radar->export_threads workers.
+ */
+int
+radar_print_plots_as_PDF(radar_t *radar, const char *folder,
+			 const char *paper, int color, GSList *plots)
+{
+	GThreadPool *pool = NULL;
+	pdf_strings_t *strings;
+	GError *error;
+	pdf_job_t *jobs, *job;
+	char **filenames;
+	char *current;
+	int nthreads, nplots, njobs, i;
+	GSList *l;
+	int ret = 0;
+
+	/* the table cells need pdf_char_bullet */
+	if (NULL == pdf_font_lookup(PDF_FONT_NAME))
+		return -1;
+
+	current = pdf_save_current(radar);
+	if (NULL == current)
+		return -1;
+
+	nthreads = radar->export_threads;
+	if (nthreads <= 0)
+		nthreads = raster_nr_cpus();
+
+	if (nthreads > 1 && g_thread_supported()) {
+		error = NULL;
+		pool = g_thread_pool_new(pdf_job_func, NULL, nthreads,
+					 FALSE, &error);
+		if (NULL == pool) {
+			fprintf(stderr, "%s: g_thread_pool_new: %s\n",
+				__FUNCTION__, error->message);
+			g_error_free(error);
+		}
+	}
+
+	strings = pdf_strings_new();
+	filenames = pdf_plot_filenames(folder, plots);
+	nplots = g_slist_length(plots);
+	jobs = g_new0(pdf_job_t, nplots);
+	njobs = 0;
+
+	for (l = plots, i = 0; l; l = l->next, i++) {
+		if (radar_load(radar, l->data) < 0) {
+			fprintf(stderr, "%s:%u: skipping '%s'\n",
+				__FUNCTION__, __LINE__, (char *) l->data);
+			ret = -1;
+			continue;
+		}
+
+		job = &jobs[njobs++];
+		job->strings = strings;
+		job->snap = pdf_snapshot_new(radar);
+		job->filename = filenames[i];
+		job->paper = paper;
+		job->color = color;
+		filenames[i] = NULL;
+
+		if (pool)
+			g_thread_pool_push(pool, job, NULL);
+		else
+			pdf_job_func(job, NULL);
+	}
+
+	if (pool)
+		g_thread_pool_free(pool, FALSE, TRUE);
+
+	for (i = 0; i < njobs; i++) {
+		if (jobs[i].ret < 0) {
+			fprintf(stderr, "%s:%u: '%s' not written\n",
+				__FUNCTION__, __LINE__, jobs[i].filename);
+			ret = -1;
+		}
+		g_free(jobs[i].filename);
+	}
+	g_free(jobs);
+
+	/* those of plots that were skipped */
+	for (i = 0; i < nplots; i++)
+		g_free(filenames[i]);
+	g_free(filenames);
+
+	pdf_strings_free(strings);
+	pdf_restore_current(radar, current);
+	return ret;
 }
 
 
@@ -3223,7 +3689,7 @@ sizer_aspect_toggled(GtkToggleButton *toggle, gpointer user_data)
 
 static void
 radar_init_size_chooser(size_chooser_t *sizer, int width, int height,
-			int extra_rows, int extra_cols)
+			int max_size, int extra_rows, int extra_cols)
 {
 	memset(sizer, 0, sizeof(size_chooser_t));
 
@@ -3240,7 +3706,7 @@ radar_init_size_chooser(size_chooser_t *sizer, int width, int height,
 			 0, 1, 0, 1,
 			 0, GTK_EXPAND, 0, 0);
 	sizer->width_spin = GTK_SPIN_BUTTON(
-				radar_init_spin(320, 2048, 1, 10, width));
+				radar_init_spin(320, max_size, 1, 10, width));
 	gtk_tooltips_set_tip(sizer->tooltips, GTK_WIDGET(sizer->width_spin),
 			     _("Width of Image in Pixels"), NULL);
 	g_signal_connect(G_OBJECT(sizer->width_spin), "value-changed",
@@ -3256,7 +3722,7 @@ radar_init_size_chooser(size_chooser_t *sizer, int width, int height,
 			 2, 3, 0, 1,
 			 0, GTK_EXPAND, 0, 0);
 	sizer->height_spin = GTK_SPIN_BUTTON(
-				radar_init_spin(320, 2048, 1, 10, height));
+				radar_init_spin(320, max_size, 1, 10, height));
 	gtk_tooltips_set_tip(sizer->tooltips, GTK_WIDGET(sizer->height_spin),
 			     _("Height of Image in Pixels"), NULL);
 	g_signal_connect(G_OBJECT(sizer->height_spin), "value-changed",
@@ -3330,7 +3796,8 @@ radar_export_jpeg(GtkAction *action, gpointer user_data)
 						    radar->image_pathname);
 	}
 
-	radar_init_size_chooser(&sizer, radar->w, radar->h, 0, 2);
+	radar_init_size_chooser(&sizer, radar->w, radar->h,
+				IMAGE_MAX_SIZE, 0, 2);
 
 	quality_label = gtk_label_new(_("JPEG Quality:"));
 	gtk_misc_set_alignment(GTK_MISC(quality_label), 0.0, 0.5);
@@ -3424,7 +3891,8 @@ radar_export_png(GtkAction *action, gpointer user_data)
 						    radar->image_pathname);
 	}
 
-	radar_init_size_chooser(&sizer, radar->w, radar->h, 0, 0);
+	radar_init_size_chooser(&sizer, radar->w, radar->h,
+				PNG_MAX_SIZE, 0, 0);
 	gtk_widget_show_all(sizer.table);
 
 	gtk_file_chooser_set_extra_widget(chooser, sizer.table);
@@ -3465,10 +3933,17 @@ out:
 	gtk_widget_destroy(dialog);
 }
 
-void
-radar_export_pdf(GtkAction *action, gpointer user_data)
+typedef struct {
+	GtkWidget	*dialog;
+	GtkWidget	*combo;
+	GtkWidget	*button;
+	GtkFileChooserAction action;	/* save a file or select a folder */
+} pdf_chooser_t;
+
+static void
+pdf_chooser_init(pdf_chooser_t *pc, radar_t *radar, const char *title,
+		 GtkFileChooserAction action)
 {
-	radar_t *radar = user_data;
 	GtkFileChooser *chooser;
 	GtkFileFilter *filter;
 	GtkWidget *dialog;
@@ -3477,14 +3952,11 @@ radar_export_pdf(GtkAction *action, gpointer user_data)
 	GtkWidget *combo;
 	GtkWidget *button;
 	GSList *group;
-	char *p, *filename;
-	char *pathname;
-	gboolean color;
-	int i, index;
+	int i;
 
-	dialog = gtk_file_chooser_dialog_new(_("Print to PDF File"),
+	dialog = gtk_file_chooser_dialog_new(title,
 					     GTK_WINDOW(radar->window),
-					     GTK_FILE_CHOOSER_ACTION_SAVE,
+					     action,
 					     GTK_STOCK_CANCEL,
 					     GTK_RESPONSE_CANCEL,
 					     GTK_STOCK_SAVE,
@@ -3495,10 +3967,12 @@ radar_export_pdf(GtkAction *action, gpointer user_data)
 	gtk_file_chooser_set_local_only(chooser, TRUE);
 	gtk_file_chooser_set_select_multiple(chooser, FALSE);
 
-	filter = gtk_file_filter_new();
-	gtk_file_filter_add_pattern(filter, "*.pdf");
-	gtk_file_filter_set_name(filter, _("PDF Files"));
-	gtk_file_chooser_set_filter(chooser, filter);
+	if (action == GTK_FILE_CHOOSER_ACTION_SAVE) {
+		filter = gtk_file_filter_new();
+		gtk_file_filter_add_pattern(filter, "*.pdf");
+		gtk_file_filter_set_name(filter, _("PDF Files"));
+		gtk_file_chooser_set_filter(chooser, filter);
+	}
 
 	if (radar->image_pathname) {
 		gtk_file_chooser_set_current_folder(GTK_FILE_CHOOSER(dialog),
@@ -3558,11 +4032,29 @@ radar_export_pdf(GtkAction *action, gpointer user_data)
 
 	gtk_file_chooser_set_extra_widget(chooser, table);
 
-	if (gtk_dialog_run(GTK_DIALOG(dialog)) != GTK_RESPONSE_ACCEPT)
-		goto out;
+	pc->dialog = dialog;
+	pc->combo = combo;
+	pc->button = button;
+	pc->action = action;
+}
+
+/*
+ * Filename with ".pdf" appended if missing, or the folder selected,
+ * paper and color setting.
+ */
+static char *
+pdf_chooser_run(pdf_chooser_t *pc, radar_t *radar, const char **paper,
+		gboolean *color)
+{
+	char *p, *filename;
+	char *pathname;
+	int index;
+
+	if (gtk_dialog_run(GTK_DIALOG(pc->dialog)) != GTK_RESPONSE_ACCEPT)
+		return NULL;
 
 	pathname = gtk_file_chooser_get_current_folder(
-						GTK_FILE_CHOOSER(dialog));
+						GTK_FILE_CHOOSER(pc->dialog));
 	if (pathname) {
 		if (radar->image_pathname) {
 			g_free(radar->image_pathname);
@@ -3570,30 +4062,169 @@ radar_export_pdf(GtkAction *action, gpointer user_data)
 		radar->image_pathname = pathname;
 	}
 
-	filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
+	filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(pc->dialog));
 
 	p = strrchr(filename, '.');
-	if ((NULL == p) || strcasecmp(p, ".pdf")) {
+	if ((pc->action == GTK_FILE_CHOOSER_ACTION_SAVE) &&
+	    ((NULL == p) || strcasecmp(p, ".pdf"))) {
 		p = g_malloc(strlen(filename) + 5);
 		sprintf(p, "%s.pdf", filename);
 		g_free(filename);
 		filename = p;
 	}
 
-	index = gtk_combo_box_get_active(GTK_COMBO_BOX(combo));
-	color = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(button)) ?
+	index = gtk_combo_box_get_active(GTK_COMBO_BOX(pc->combo));
+	*paper = paper_formats[index].name;
+	*color = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(pc->button)) ?
 								FALSE : TRUE;
 
-	gdk_window_set_cursor(dialog->window, radar->busy_cursor);
+	gdk_window_set_cursor(pc->dialog->window, radar->busy_cursor);
+
+	return filename;
+}
+
+void
+radar_export_pdf(GtkAction *action, gpointer user_data)
+{
+	radar_t *radar = user_data;
+	pdf_chooser_t pc;
+	const char *paper;
+	char *filename;
+	gboolean color;
+
+	pdf_chooser_init(&pc, radar, _("Print to PDF File"),
+			 GTK_FILE_CHOOSER_ACTION_SAVE);
+
+	filename = pdf_chooser_run(&pc, radar, &paper, &color);
+	if (NULL == filename)
+		goto out;
 
 	bind_textdomain_codeset("radarplot", "ISO-8859-1");
 
-	radar_print_as_PDF(radar, filename, paper_formats[index].name, color);
+	radar_print_as_PDF(radar, filename, paper, color);
 
 	bind_textdomain_codeset("radarplot", "UTF-8");
 
 	g_free(filename);
 
 out:
+	gtk_widget_destroy(pc.dialog);
+}
+
+/*
+ * List of plot files chosen by the user, or NULL.
+ */
+static GSList *
+pdf_choose_plots(radar_t *radar, const char *title)
+{
+	GtkFileChooser *chooser;
+	GtkFileFilter *filter;
+	GtkWidget *dialog;
+	GSList *plots = NULL;
+
+	dialog = gtk_file_chooser_dialog_new(title,
+					     GTK_WINDOW(radar->window),
+					     GTK_FILE_CHOOSER_ACTION_OPEN,
+					     GTK_STOCK_CANCEL,
+					     GTK_RESPONSE_CANCEL,
+					     GTK_STOCK_OPEN,
+					     GTK_RESPONSE_ACCEPT,
+					     NULL);
+	chooser = GTK_FILE_CHOOSER(dialog);
+
+	gtk_file_chooser_set_local_only(chooser, TRUE);
+	gtk_file_chooser_set_select_multiple(chooser, TRUE);
+
+	filter = gtk_file_filter_new();
+	gtk_file_filter_add_pattern(filter, "*.rpt");
+	gtk_file_filter_set_name(filter, _("Radarplot Files"));
+	gtk_file_chooser_set_filter(chooser, filter);
+
+	if (radar->plot_pathname) {
+		gtk_file_chooser_set_current_folder(chooser,
+						    radar->plot_pathname);
+	}
+
+	if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT)
+		plots = gtk_file_chooser_get_filenames(chooser);
+
 	gtk_widget_destroy(dialog);
+	return plots;
+}
+
+static void
+pdf_free_plots(GSList *plots)
+{
+	g_slist_foreach(plots, (GFunc) g_free, NULL);
+	g_slist_free(plots);
+}
+
+void
+radar_export_report(GtkAction *action, gpointer user_data)
+{
+	radar_t *radar = user_data;
+	pdf_chooser_t pc;
+	const char *paper;
+	char *filename;
+	gboolean color;
+	GSList *plots;
+
+	plots = pdf_choose_plots(radar, _("Select radarplot files for report"));
+	if (NULL == plots)
+		return;
+
+	pdf_chooser_init(&pc, radar, _("Print Report to PDF File"),
+			 GTK_FILE_CHOOSER_ACTION_SAVE);
+
+	filename = pdf_chooser_run(&pc, radar, &paper, &color);
+	if (NULL == filename)
+		goto out;
+
+	bind_textdomain_codeset("radarplot", "ISO-8859-1");
+
+	radar_print_report_as_PDF(radar, filename, paper, color, plots);
+
+	bind_textdomain_codeset("radarplot", "UTF-8");
+
+	g_free(filename);
+
+out:
+	gtk_widget_destroy(pc.dialog);
+	pdf_free_plots(plots);
+}
+
+void
+radar_export_plots(GtkAction *action, gpointer user_data)
+{
+	radar_t *radar = user_data;
+	pdf_chooser_t pc;
+	const char *paper;
+	char *folder;
+	gboolean color;
+	GSList *plots;
+
+	plots = pdf_choose_plots(radar, _("Select radarplot files to print"));
+	if (NULL == plots)
+		return;
+
+	pdf_chooser_init(&pc, radar, _("Print each to PDF File in Folder"),
+			 GTK_FILE_CHOOSER_ACTION_SELECT_FOLDER);
+
+	folder = pdf_chooser_run(&pc, radar, &paper, &color);
+	if (NULL == folder)
+		goto out;
+
+	bind_textdomain_codeset("radarplot", "ISO-8859-1");
+
+	if (radar_print_plots_as_PDF(radar, folder, paper, color, plots) < 0)
+		fprintf(stderr, "%s: not all plots printed to '%s'\n",
+			__FUNCTION__, folder);
+
+	bind_textdomain_codeset("radarplot", "UTF-8");
+
+	g_free(folder);
+
+out:
+	gtk_widget_destroy(pc.dialog);
+	pdf_free_plots(plots);
 }
@@ -48,6 +48,7 @@
 #endif
 
 #include "radar.h"
+#include "raster.h"
 #include "license.h"
 
 #include "radar16x16.h"
@@ -59,6 +60,8 @@
 #undef DEBUG
 #undef DEBUG_BBOX
 #undef DEBUG_TEXT
+#undef DEBUG_REDRAW
+#undef DEBUG_PLAY
 
 
 range_t radar_ranges[] =
@@ -73,6 +76,12 @@ range_t radar_ranges[] =
 
 #define RADAR_NR_RANGES	(sizeof(radar_ranges) / sizeof(radar_ranges[0]))
 
+#define RADAR_MAX_FPS	60
+#define RADAR_RESIZE_DELAY	250
+
+#define RADAR_PLAY_MINUTES	60	/* length of the play slider */
+#define RADAR_PLAY_RATE		1.0	/* simulated minutes per second */
+
 static const vector_xy_t vector_xy_null = { 0.0, 0.0 };
 
 static int
@@ -81,6 +90,7 @@ lines_crossing(radar_t *radar, vector_xy_t *v1_0, vector_xy_t *v1_1,
 
 static void radar_draw_foreground(radar_t *radar);
 static void radar_draw_background(radar_t *radar);
+static void radar_schedule_redraw(radar_t *radar, gboolean background);
 
 static void radar_draw_segments(radar_t *radar, GdkDrawable *drawable,
 				GdkGC *gc, GdkPixbuf *pixbuf, guchar alpha,
@@ -268,6 +278,9 @@ radar_new(GtkAction *action, gpointer user_data)
 	gtk_spin_button_set_value(radar->ncourse_spin, 0.0);
 	gtk_spin_button_set_value(radar->nspeed_spin, 0.0);
 
+	gtk_toggle_button_set_active(radar->play_toggle, FALSE);
+	gtk_range_set_value(radar->play_scale, 0.0);
+
 	gtk_widget_grab_focus(GTK_WIDGET(radar->own_course_spin));
 
 	radar_draw_foreground(radar);
@@ -366,7 +379,7 @@ out:
 	return d;
 }
 
-static int
+int
 radar_load(radar_t *radar, const char *filename)
 {
 	char group_name[32];
@@ -747,7 +760,7 @@ out:
 	gtk_widget_destroy(dialog);
 }
 
-static int
+int
 radar_save(radar_t *radar, const char *filename)
 {
 	char group_name[32];
@@ -1026,6 +1039,16 @@ static GtkActionEntry ui_entries[] =
 		  N_("Print radarplot to PDF file"),
 		  G_CALLBACK(radar_export_pdf)
 		},
+		{ "Report",		NULL,
+		  N_("Print _Report as PDF"),	NULL,
+		  N_("Print several radarplot files to one PDF file"),
+		  G_CALLBACK(radar_export_report)
+		},
+		{ "Plots",		NULL,
+		  N_("Print _Each as PDF"),	NULL,
+		  N_("Print several radarplot files to one PDF file each"),
+		  G_CALLBACK(radar_export_plots)
+		},
 
 		{ "Exit",		GTK_STOCK_QUIT,
 		  N_("_Exit"),		"<control>E",
@@ -1088,6 +1111,8 @@ static const gchar *ui_info =
 "      </menu>"
 "      <separator/>"
 "      <menuitem action='PrintAs'/>"
+"      <menuitem action='Report'/>"
+"      <menuitem action='Plots'/>"
 "      <separator/>"
 "      <menuitem action='Exit'/>"
 "    </menu>"
@@ -1226,23 +1251,11 @@ radar_clip_vector(double x_min, double y_min, double x_max, double y_max,
 	return TRUE;
 }
 
-static int
-radar_add_trap_from_points(GList **traps, double top, double bottom,
-			   double top_left_x, double bottom_left_x,
-			   double top_right_x, double bottom_right_x)
+static void
+radar_set_trap(trapezoid_t *trap, double top, double bottom,
+	       double top_left_x, double bottom_left_x,
+	       double top_right_x, double bottom_right_x)
 {
-	trapezoid_t *trap;
-
-	if (top == bottom)
-		return 0;
-
-	trap = malloc(sizeof(trapezoid_t));
-	if (NULL == trap) {
-		printf("%s:%u: malloc(trapezoid_t) failed\n",
-		       __FUNCTION__, __LINE__);
-		return -ENOMEM;
-	}
-
 	trap->y1 = top;
 	trap->y2 = bottom;
 
@@ -1261,10 +1274,31 @@ radar_add_trap_from_points(GList **traps, double top, double bottom,
 		trap->x12 = bottom_left_x;
 		trap->x22 = bottom_right_x;
 	}
+}
+
+static int
+radar_add_trap_from_points(GList **traps, double top, double bottom,
+			   double top_left_x, double bottom_left_x,
+			   double top_right_x, double bottom_right_x)
+{
+	trapezoid_t *trap;
+
+	if (top == bottom)
+		return 0;
+
+	trap = malloc(sizeof(trapezoid_t));
+	if (NULL == trap) {
+		printf("%s:%u: malloc(trapezoid_t) failed\n",
+		       __FUNCTION__, __LINE__);
+		return -ENOMEM;
+	}
 
-	*traps = g_list_append(*traps, trap);
+	radar_set_trap(trap, top, bottom, top_left_x, bottom_left_x,
+		       top_right_x, bottom_right_x);
+
+	*traps = g_list_prepend(*traps, trap);
 	if (NULL == *traps) {
-		printf("%s:%u: g_list_append() failed\n",
+		printf("%s:%u: g_list_prepend() failed\n",
 		       __FUNCTION__, __LINE__);
 		return -ENOMEM;
 	}
@@ -1369,6 +1403,117 @@ radar_tessellate_line(double x1, double y1, double x2, double y2,
 	return 0;
 }
 
+/*
+ * Rectangle as radar_tessellate_rectangle() does it, into traps[],
+ * which has room for three.  Returns the number of trapezoids.
+ */
+static int
+radar_rectangle_traps(const point_t *points, trapezoid_t *traps)
+{
+	point_t t[4], p;
+	double isec02, isec13;
+	int i, k, n = 0;
+
+	for (i = 0; i < 4; i++) {
+		p = points[i];
+		for (k = i; k > 0 && radar_compare_points(&t[k - 1], &p) > 0; k--)
+			t[k] = t[k - 1];
+		t[k] = p;
+	}
+
+	isec02 = radar_compute_x(&t[0], &t[2], t[1].y);
+	isec13 = radar_compute_x(&t[1], &t[3], t[2].y);
+
+	if (t[0].y != t[1].y)
+		radar_set_trap(&traps[n++], t[0].y, t[1].y,
+			       t[0].x, isec02, t[0].x, t[1].x);
+	if (t[1].y != t[2].y)
+		radar_set_trap(&traps[n++], t[1].y, t[2].y,
+			       isec02, t[2].x, t[1].x, isec13);
+	if (t[2].y != t[3].y)
+		radar_set_trap(&traps[n++], t[2].y, t[3].y,
+			       t[2].x, t[3].x, isec13, t[3].x);
+
+	return n;
+}
+
+/*
+ * All dashes of a line, dashes[0] on and dashes[1] off, from one
+ * direction vector into one array of *ntraps trapezoids, to be
+ * g_free()d by the caller.
+ */
+static void
+radar_tessellate_dashes(double x1, double y1, double x2, double y2,
+			double width, const double *dashes,
+			trapezoid_t **trapsp, int *ntraps)
+{
+	double dx, dy, l, nx, ny, ux, uy;
+	double r1, r2, period;
+	point_t points[4];
+	trapezoid_t *traps;
+	int n = 0;
+
+	*trapsp = NULL;
+	*ntraps = 0;
+
+	dx = x2 - x1;
+	dy = y2 - y1;
+	l = sqrt(dx * dx + dy * dy);
+	if (l == 0.0)
+		return;
+
+	ux = dx / l;
+	uy = dy / l;
+	nx = -uy * width / 2.0;
+	ny = ux * width / 2.0;
+
+	period = dashes[0] + dashes[1];
+	traps = g_new(trapezoid_t, 3 * ((int) (l / period) + 1));
+
+	for (r1 = 0.0; r1 < l; r1 += period) {
+		r2 = r1 + dashes[0];
+		if (r2 > l)
+			r2 = l;
+
+		points[0].x = x1 + r1 * ux + nx;
+		points[0].y = y1 + r1 * uy + ny;
+		points[1].x = x1 + r1 * ux - nx;
+		points[1].y = y1 + r1 * uy - ny;
+		points[2].x = x1 + r2 * ux + nx;
+		points[2].y = y1 + r2 * uy + ny;
+		points[3].x = x1 + r2 * ux - nx;
+		points[3].y = y1 + r2 * uy - ny;
+
+		n += radar_rectangle_traps(points, &traps[n]);
+	}
+
+	*trapsp = traps;
+	*ntraps = n;
+}
+
+static guint32
+radar_gc_rgb(GdkGC *gc)
+{
+	GdkGCValues values;
+	GdkColormap *cmap;
+	GdkColor color;
+
+	gdk_gc_get_values(gc, &values);
+	color.pixel = values.foreground.pixel;
+
+	cmap = gdk_gc_get_colormap(gc);
+	if (cmap) {
+		gdk_colormap_query_color(cmap, color.pixel, &color);
+	} else {
+		printf("%s:%u: gdk_gc_get_colormap(%p) failed\n",
+		       __FUNCTION__, __LINE__, gc);
+		return 0;
+	}
+
+	return ((color.red >> 8) << 16) | ((color.green >> 8) << 8) |
+	       (color.blue >> 8);
+}
+
 static void
 radar_gdk_draw_trapezoids(GdkDrawable *drawable, GdkGC *gc,
 			  GdkTrapezoid *trapezoids, gint n_trapezoids)
@@ -1423,6 +1568,11 @@ radar_draw_traps(radar_t *radar, GdkDrawable *drawable, GdkGC *gc,
 	if (NULL == *traps)
 		return;
 
+	if (radar->raster) {
+		raster_add_traps(radar->raster, radar_gc_rgb(gc), alpha, *traps);
+		return;
+	}
+
 	p = *traps;
 	for (i = 0; i < n; i++) {
 		trap = p->data;
@@ -1441,110 +1591,456 @@ radar_draw_traps(radar_t *radar, GdkDrawable *drawable, GdkGC *gc,
 }
 
 static void
-radar_draw_layout(radar_t *radar, GdkDrawable *drawable,
-		  GdkGC *fg_gc, GdkGC *bg_gc,
-		  GdkPixbuf *pixbuf, guchar alpha, gboolean render,
-		  double x, double y, int width, int height,
-		  PangoLayout *layout)
-{
-	GdkPixmap *testmap, *pixmap;
-	GdkPixbuf *testbuf;
-	GdkGCValues values;
-	GdkColormap *cmap;
-	GdkColor gdk_color;
-	guchar *data, *p;
-	guchar r, g, b;
-	guint stride;
-	int row, col;
+radar_draw_trap_array(radar_t *radar, GdkDrawable *drawable, GdkGC *gc,
+		      guchar alpha, const trapezoid_t *traps, int n)
+{
+	GdkTrapezoid *trapezoids;
+	int i;
 
-	gdk_gc_get_values(bg_gc, &values);
-	gdk_color.pixel = values.foreground.pixel;
+	if (0 == n)
+		return;
 
-	cmap = gdk_gc_get_colormap(bg_gc);
-	if (cmap) {
-		gdk_colormap_query_color(cmap, gdk_color.pixel,
-					 &gdk_color);
-	} else {
-		printf("%s:%u: gdk_gc_get_colormap(%p) failed\n",
-		       __FUNCTION__, __LINE__, bg_gc);
+	if (radar->raster) {
+		raster_add_trap_array(radar->raster, radar_gc_rgb(gc), alpha,
+				      traps, n);
 		return;
 	}
 
-	r = gdk_color.red >> 8;
-	g = gdk_color.green >> 8;
-	b = gdk_color.blue >> 8;
-
-
-	testmap = gdk_pixmap_new(drawable, width + 4, height + 4, -1);
-	if (NULL == testmap) {
-		printf("%s:%u: gdk_pixmap_new(%u, %u) failed\n",
-		       __FUNCTION__, __LINE__, width + 4, height + 4);
-		return;
+	trapezoids = g_new(GdkTrapezoid, n);
+	for (i = 0; i < n; i++) {
+		trapezoids[i].y1 = traps[i].y1;
+		trapezoids[i].x11 = traps[i].x11;
+		trapezoids[i].x21 = traps[i].x21;
+		trapezoids[i].y2 = traps[i].y2;
+		trapezoids[i].x12 = traps[i].x12;
+		trapezoids[i].x22 = traps[i].x22;
 	}
-	gdk_draw_rectangle(testmap, bg_gc, TRUE,
-			   0, 0, width + 4, height + 4);
-	gdk_draw_layout(testmap, fg_gc, 2, 2, layout);
 
+	radar_gdk_draw_trapezoids(drawable, gc, trapezoids, n);
+	g_free(trapezoids);
+}
+
+static GdkPixbuf *
+radar_render_pixmap(radar_t *radar, GdkDrawable *drawable, GdkGC *gc,
+		    int width, int height, PangoLayout *layout,
+		    GdkColor *fg, GdkColor *bg)
+{
+	GdkPixmap *pixmap;
+	GdkPixbuf *pixbuf;
 
-	pixmap = gdk_pixmap_new(drawable, width + 4, height + 4, -1);
+	pixmap = gdk_pixmap_new(drawable, width, height, -1);
 	if (NULL == pixmap) {
 		printf("%s:%u: gdk_pixmap_new(%u, %u) failed\n",
-		       __FUNCTION__, __LINE__, width + 4, height + 4);
-		g_object_unref(testmap);
-		return;
-	}
-	if (pixbuf && render) {
-		gdk_draw_pixbuf(pixmap, fg_gc, pixbuf,
-				d2i(x) - 2, d2i(y) - 2,
-				0, 0, width + 4, height + 4,
-				GDK_RGB_DITHER_NORMAL, 0, 0);
-	} else {
-		gdk_draw_drawable(pixmap, fg_gc, drawable,
-				  d2i(x) - 2, d2i(y) - 2,
-				  0, 0, width + 4, height + 4);
+		       __FUNCTION__, __LINE__, width, height);
+		return NULL;
 	}
 
-	testbuf = gdk_pixbuf_get_from_drawable(NULL, testmap, cmap, 0, 0,
-					       0, 0, width + 4, height + 4);
-	if (NULL == testbuf) {
+	gdk_draw_rectangle(pixmap, gc, TRUE, 0, 0, width, height);
+	gdk_draw_layout_with_colors(pixmap, gc, 2, 2, layout, fg, bg);
+
+	pixbuf = gdk_pixbuf_get_from_drawable(NULL, pixmap,
+					      gdk_gc_get_colormap(gc),
+					      0, 0, 0, 0, width, height);
+	if (NULL == pixbuf) {
 		printf("%s:%u: gdk_pixbuf_get_from_drawable(%u, %u) failed\n",
-		       __FUNCTION__, __LINE__, width + 4, height + 4);
-		g_object_unref(pixmap);
-		g_object_unref(testmap);
-		return;
+		       __FUNCTION__, __LINE__, width, height);
+	}
+
+	g_object_unref(pixmap);
+	return pixbuf;
+}
+
+/*
+ * Composite fg with glyph coverage cov over a halo in bg, made of the
+ * coverage moved one pixel left, right, up and down.
+ */
+static GdkPixbuf *
+radar_compose_label_cross(guchar *cov, int width, int height,
+			  guint32 fg, guint32 bg)
+{
+	GdkPixbuf *pixbuf;
+	guchar *data, *p;
+	guint fa, ba, oa, h;
+	guint stride;
+	int row, col, i;
+
+	pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, TRUE, 8, width, height);
+	if (NULL == pixbuf) {
+		printf("%s:%u: gdk_pixbuf_new(%u, %u) failed\n",
+		       __FUNCTION__, __LINE__, width, height);
+		return NULL;
+	}
+
+	data = gdk_pixbuf_get_pixels(pixbuf);
+	stride = gdk_pixbuf_get_rowstride(pixbuf);
+	for (row = 0; row < height; row++) {
+		p = data + row * stride;
+
+		for (col = 0; col < width; col++, p += 4) {
+			i = row * width + col;
+
+			h = 0;
+			if (col > 0)
+				h = MAX(h, cov[i - 1]);
+			if (col < width - 1)
+				h = MAX(h, cov[i + 1]);
+			if (row > 0)
+				h = MAX(h, cov[i - width]);
+			if (row < height - 1)
+				h = MAX(h, cov[i + width]);
+
+			fa = cov[i] * 255;
+			ba = h * (255 - cov[i]);
+			oa = fa + ba;
+			if (0 == oa) {
+				p[0] = p[1] = p[2] = p[3] = 0;
+				continue;
+			}
+
+			p[0] = (((fg >> 16) & 0xff) * fa +
+				((bg >> 16) & 0xff) * ba) / oa;
+			p[1] = (((fg >> 8) & 0xff) * fa +
+				((bg >> 8) & 0xff) * ba) / oa;
+			p[2] = ((fg & 0xff) * fa + (bg & 0xff) * ba) / oa;
+			p[3] = (oa + 127) / 255;
+		}
 	}
 
+	return pixbuf;
+}
+
+/*
+ * Label with antialiased glyphs and a halo of the glyph shape moved
+ * one pixel left, right, up and down.  The layout is rendered once
+ * white on black to get glyph coverage.
+ */
+static GdkPixbuf *
+radar_render_label_cross(radar_t *radar, GdkDrawable *drawable,
+			 guint32 fg, guint32 bg, int width, int height,
+			 PangoLayout *layout)
+{
+	static GdkColor white = { 0, 0xffff, 0xffff, 0xffff };
+	static GdkColor black = { 0, 0, 0, 0 };
+	GdkPixbuf *testbuf, *pixbuf;
+	guchar *cov, *data, *p;
+	guint stride;
+	int row, col;
+
+	testbuf = radar_render_pixmap(radar, drawable, radar->black_gc,
+				      width, height, layout, &white, &black);
+	if (NULL == testbuf)
+		return NULL;
+
+	cov = g_malloc(width * height);
+
 	data = gdk_pixbuf_get_pixels(testbuf);
 	stride = gdk_pixbuf_get_rowstride(testbuf);
-	for (row = 0; row < height + 4; row++) {
-		p = data;
+	for (row = 0; row < height; row++) {
+		p = data + row * stride;
+		for (col = 0; col < width; col++, p += 3)
+			cov[row * width + col] = p[1];
+	}
+	g_object_unref(testbuf);
+
+	pixbuf = radar_compose_label_cross(cov, width, height, fg, bg);
+
+	g_free(cov);
+	return pixbuf;
+}
 
-		for (col = 0; col < width + 4; col++, p += 3) {
-			if (p[0] == r && p[1] == g && p[2] == b)
+/*
+ * Label drawn opaque over a 3x3 halo around each pixel the glyphs
+ * touch.  The layout is rendered on bg for the colors, and once more
+ * on fg to find what the layout paints itself (background attribute).
+ */
+static GdkPixbuf *
+radar_render_label_box(radar_t *radar, GdkDrawable *drawable,
+		       GdkGC *fg_gc, GdkGC *bg_gc, guint32 fg, guint32 bg,
+		       int width, int height, PangoLayout *layout)
+{
+	GdkPixbuf *testbuf, *paintbuf, *pixbuf;
+	guchar *data, *test, *paint, *p, *q;
+	guint stride, tstride, pstride;
+	guint32 rgb;
+	int row, col, i, j;
+
+	testbuf = radar_render_pixmap(radar, drawable, bg_gc, width, height,
+				      layout, NULL, NULL);
+	if (NULL == testbuf)
+		return NULL;
+
+	paintbuf = radar_render_pixmap(radar, drawable, fg_gc, width, height,
+				       layout, NULL, NULL);
+	if (NULL == paintbuf) {
+		g_object_unref(testbuf);
+		return NULL;
+	}
+
+	pixbuf = gdk_pixbuf_add_alpha(testbuf, FALSE, 0, 0, 0);
+	if (NULL == pixbuf) {
+		printf("%s:%u: gdk_pixbuf_add_alpha(%u, %u) failed\n",
+		       __FUNCTION__, __LINE__, width, height);
+		g_object_unref(paintbuf);
+		g_object_unref(testbuf);
+		return NULL;
+	}
+
+	data = gdk_pixbuf_get_pixels(pixbuf);
+	stride = gdk_pixbuf_get_rowstride(pixbuf);
+	test = gdk_pixbuf_get_pixels(testbuf);
+	tstride = gdk_pixbuf_get_rowstride(testbuf);
+	paint = gdk_pixbuf_get_pixels(paintbuf);
+	pstride = gdk_pixbuf_get_rowstride(paintbuf);
+
+	for (row = 0; row < height; row++) {
+		p = data + row * stride;
+		q = paint + row * pstride;
+
+		for (col = 0; col < width; col++, p += 4, q += 3) {
+			rgb = (q[0] << 16) | (q[1] << 8) | q[2];
+			p[3] = (rgb != fg) ? 0xff : 0;
+		}
+	}
+
+	for (row = 0; row < height; row++) {
+		q = test + row * tstride;
+
+		for (col = 0; col < width; col++, q += 3) {
+			rgb = (q[0] << 16) | (q[1] << 8) | q[2];
+			if (rgb == bg)
 				continue;
 
-			gdk_draw_rectangle(pixmap, bg_gc, TRUE,
-					   col - 1, row - 1, 3, 3);
+			for (j = MAX(row - 1, 0);
+			     j <= MIN(row + 1, height - 1); j++) {
+				p = data + j * stride;
+				for (i = MAX(col - 1, 0);
+				     i <= MIN(col + 1, width - 1); i++)
+					p[i * 4 + 3] = 0xff;
+			}
 		}
+	}
 
-		data += stride;
+	g_object_unref(paintbuf);
+	g_object_unref(testbuf);
+	return pixbuf;
+}
+
+/*
+ * Offscreen label, without any X drawable: the layout (from a cairo
+ * font map) is drawn in fg into an image surface, its alpha channel
+ * gives the coverage for either halo style.
+ */
+static GdkPixbuf *
+radar_render_label_image(guint32 fg, guint32 bg, label_halo_t halo,
+			 int width, int height, PangoLayout *layout)
+{
+	cairo_surface_t *surface;
+	GdkPixbuf *pixbuf;
+	guchar *cov, *data, *p;
+	guint32 *s, v;
+	guint a, stride, sstride;
+	cairo_t *cr;
+	int row, col, i, j;
+
+	surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+					     width, height);
+	if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
+		printf("%s:%u: cairo_image_surface_create(%u, %u) failed\n",
+		       __FUNCTION__, __LINE__, width, height);
+		cairo_surface_destroy(surface);
+		return NULL;
+	}
+
+	cr = cairo_create(surface);
+	cairo_set_source_rgb(cr, ((fg >> 16) & 0xff) / 255.0,
+				 ((fg >> 8) & 0xff) / 255.0,
+				 (fg & 0xff) / 255.0);
+	cairo_move_to(cr, 2, 2);
+	pango_cairo_show_layout(cr, layout);
+	cairo_destroy(cr);
+	cairo_surface_flush(surface);
+
+	sstride = cairo_image_surface_get_stride(surface);
+
+	cov = g_malloc(width * height);
+	for (row = 0; row < height; row++) {
+		s = (guint32 *) (cairo_image_surface_get_data(surface) +
+				 row * sstride);
+		for (col = 0; col < width; col++)
+			cov[row * width + col] = s[col] >> 24;
 	}
 
-	gdk_draw_layout(pixmap, fg_gc, 2, 2, layout);
+	if (halo == LABEL_HALO_CROSS) {
+		pixbuf = radar_compose_label_cross(cov, width, height, fg, bg);
+		goto out;
+	}
 
-	if (pixbuf && render) {
-		gdk_pixbuf_get_from_drawable(pixbuf, pixmap, cmap,
-					     0, 0, d2i(x) - 2, d2i(y) - 2,
-					     width + 4, height + 4);
-	} else {
-		gdk_draw_drawable(drawable, fg_gc, pixmap,
-				  0, 0, d2i(x) - 2, d2i(y) - 2,
-				  width + 4, height + 4);
+	pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, TRUE, 8, width, height);
+	if (NULL == pixbuf) {
+		printf("%s:%u: gdk_pixbuf_new(%u, %u) failed\n",
+		       __FUNCTION__, __LINE__, width, height);
+		goto out;
 	}
 
-	g_object_unref(testbuf);
-	g_object_unref(pixmap);
-	g_object_unref(testmap);
+	data = gdk_pixbuf_get_pixels(pixbuf);
+	stride = gdk_pixbuf_get_rowstride(pixbuf);
+
+	for (row = 0; row < height; row++) {
+		s = (guint32 *) (cairo_image_surface_get_data(surface) +
+				 row * sstride);
+		p = data + row * stride;
+
+		for (col = 0; col < width; col++, p += 4) {
+			v = s[col];
+			a = 255 - (v >> 24);
+
+			p[0] = ((v >> 16) & 0xff) +
+			       (((bg >> 16) & 0xff) * a + 127) / 255;
+			p[1] = ((v >> 8) & 0xff) +
+			       (((bg >> 8) & 0xff) * a + 127) / 255;
+			p[2] = (v & 0xff) + ((bg & 0xff) * a + 127) / 255;
+			p[3] = 0;
+
+			for (j = MAX(row - 1, 0);
+			     j <= MIN(row + 1, height - 1) && !p[3]; j++) {
+				for (i = MAX(col - 1, 0);
+				     i <= MIN(col + 1, width - 1); i++) {
+					if (cov[j * width + i]) {
+						p[3] = 0xff;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+out:
+	g_free(cov);
+	cairo_surface_destroy(surface);
+	return pixbuf;
+}
+
+static void
+radar_free_label_bitmap(gpointer data)
+{
+	label_bitmap_t *label = data;
+
+	g_object_unref(label->pixbuf);
+	g_free(label->key);
+	g_free(label);
+}
+
+/*
+ * Look up the rendered bitmap of text (or markup) in fg on bg.  Only
+ * on a miss the text is set on the layout, so a hit costs no Pango
+ * layout or rasterization at all.  Least recently used bitmaps are
+ * dropped beyond LABEL_CACHE_SIZE entries.
+ */
+static label_bitmap_t *
+radar_lookup_label(radar_t *radar, GdkDrawable *drawable,
+		   GdkGC *fg_gc, GdkGC *bg_gc, label_halo_t halo,
+		   PangoLayout *layout, const char *text, gboolean markup)
+{
+	const PangoFontDescription *font_description;
+	label_bitmap_t *label;
+	GdkPixbuf *pixbuf;
+	guint32 fg, bg;
+	gchar *font, *key;
+	GList *link;
+	int tw, th;
+
+	fg = radar_gc_rgb(fg_gc);
+	bg = radar_gc_rgb(bg_gc);
+
+	font_description = pango_layout_get_font_description(layout);
+	if (font_description)
+		font = pango_font_description_to_string(font_description);
+	else
+		font = g_strdup("");
+
+	key = g_strdup_printf("%u%c%c%06x%06x%s\n%s", halo,
+			      drawable ? 'X' : 'O', markup ? 'M' : 'T',
+			      fg, bg, font, text);
+	g_free(font);
+
+	label = g_hash_table_lookup(radar->label_cache, key);
+	if (label) {
+		g_queue_unlink(radar->label_lru, label->link);
+		g_queue_push_head_link(radar->label_lru, label->link);
+		g_free(key);
+		return label;
+	}
+
+	if (markup)
+		pango_layout_set_markup(layout, text, -1);
+	else
+		pango_layout_set_text(layout, text, -1);
+	pango_layout_get_pixel_size(layout, &tw, &th);
+
+	if (NULL == drawable)
+		pixbuf = radar_render_label_image(fg, bg, halo,
+						  tw + 4, th + 4, layout);
+	else if (halo == LABEL_HALO_BOX)
+		pixbuf = radar_render_label_box(radar, drawable, fg_gc, bg_gc,
+						fg, bg, tw + 4, th + 4, layout);
+	else
+		pixbuf = radar_render_label_cross(radar, drawable, fg, bg,
+						  tw + 4, th + 4, layout);
+	if (NULL == pixbuf) {
+		g_free(key);
+		return NULL;
+	}
+
+	label = g_new(label_bitmap_t, 1);
+	label->key = key;
+	label->pixbuf = pixbuf;
+	label->tw = tw;
+	label->th = th;
+	label->link = g_list_alloc();
+	label->link->data = label;
+
+	g_queue_push_head_link(radar->label_lru, label->link);
+	g_hash_table_insert(radar->label_cache, label->key, label);
+
+	while (g_queue_get_length(radar->label_lru) > LABEL_CACHE_SIZE) {
+		link = g_queue_pop_tail_link(radar->label_lru);
+		g_hash_table_remove(radar->label_cache,
+				    ((label_bitmap_t *) link->data)->key);
+		g_list_free_1(link);
+	}
+
+	return label;
+}
+
+static void
+radar_draw_label_bitmap(radar_t *radar, GdkDrawable *drawable, GdkGC *gc,
+			GdkPixbuf *pixbuf, guchar alpha, gboolean render,
+			label_bitmap_t *label, int x, int y)
+{
+	int width, height;
+	int dx, dy, dw, dh;
+
+	width = gdk_pixbuf_get_width(label->pixbuf);
+	height = gdk_pixbuf_get_height(label->pixbuf);
+	x -= 2;
+	y -= 2;
+
+	if (radar->raster) {
+		raster_add_image(radar->raster, label->pixbuf, x, y, alpha);
+	} else if (pixbuf && render) {
+		dx = MAX(x, 0);
+		dy = MAX(y, 0);
+		dw = MIN(x + width, gdk_pixbuf_get_width(pixbuf)) - dx;
+		dh = MIN(y + height, gdk_pixbuf_get_height(pixbuf)) - dy;
+		if (dw <= 0 || dh <= 0)
+			return;
+
+		gdk_pixbuf_composite(label->pixbuf, pixbuf, dx, dy, dw, dh,
+				     x, y, 1.0, 1.0, GDK_INTERP_NEAREST, alpha);
+	} else {
+		gdk_draw_pixbuf(drawable, gc, label->pixbuf, 0, 0, x, y,
+				width, height, GDK_RGB_DITHER_NORMAL, 0, 0);
+	}
 }
 
 void
@@ -1558,14 +2054,15 @@ radar_draw_bg_pixmap(radar_t *radar, GdkDrawable *drawable,
 	double ox, oy, sina, cosa;
 	double r, ri, x, y;
 	segment_t segs[360];
-//	text_label_t label;
+	label_bitmap_t *label;
 	char text[16];
-	GdkGC *gc;
 	arc_t arc;
 	int tick;
 	int i, n;
 
-	if (pixbuf && render) {
+	if (radar->raster) {
+		raster_fill(radar->raster, 0xffffff, alpha);
+	} else if (pixbuf && render) {
 		gdk_pixbuf_fill(pixbuf, 0xffffff00 | alpha);
 	} else {
 		gdk_draw_rectangle(drawable, radar->white_gc,
@@ -1596,20 +2093,14 @@ radar_draw_bg_pixmap(radar_t *radar, GdkDrawable *drawable,
 
 		outer_sincos(radar, a, &sina, &cosa);
 
-		if (render) {
-			segs[n].x1 = cx + 3.0 * i2d(step) / 4.0 * sina;
-			segs[n].y1 = cy - 3.0 * i2d(step) / 4.0 * cosa;
-		} else {
-			segs[n].x1 = cx;
-			segs[n].y1 = cy;
-		}
+		segs[n].x1 = cx + 3.0 * i2d(step) / 4.0 * sina;
+		segs[n].y1 = cy - 3.0 * i2d(step) / 4.0 * cosa;
 		segs[n].x2 = cx + i2d(radius) * sina;
 		segs[n].y2 = cy - i2d(radius) * cosa;
 		n++;
 	}
-	gc = render ? radar->grey25_gc : radar->grey25_clip2_gc;
-	radar_draw_segments(radar, drawable, gc, pixbuf, alpha,
-			    render, segs, n);
+	radar_draw_segments(radar, drawable, radar->grey25_gc,
+			    pixbuf, alpha, render, segs, n);
 
 	n = 0;
 	for (a = 0; a < 360; a += 90) {
@@ -1631,39 +2122,27 @@ radar_draw_bg_pixmap(radar_t *radar, GdkDrawable *drawable,
 
 		outer_sincos(radar, a, &sina, &cosa);
 
-		if (render) {
-			segs[n].x1 = cx + i2d(step) / 4.0 * sina;
-			segs[n].y1 = cy - i2d(step) / 4.0 * cosa;
-		} else {
-			segs[n].x1 = cx;
-			segs[n].y1 = cy;
-		}
+		segs[n].x1 = cx + i2d(step) / 4.0 * sina;
+		segs[n].y1 = cy - i2d(step) / 4.0 * cosa;
 		segs[n].x2 = cx + i2d(radius) * sina;
 		segs[n].y2 = cy - i2d(radius) * cosa;
 		n++;
 	}
-	gc = render ? radar->grey50_gc : radar->grey50_clip3_gc;
-	radar_draw_segments(radar, drawable, gc, pixbuf, alpha,
-			    render, segs, n);
+	radar_draw_segments(radar, drawable, radar->grey50_gc,
+			    pixbuf, alpha, render, segs, n);
 
 	n = 0;
 	for (a = 5; a < 360; a += 5) {
 		outer_sincos(radar, a, &sina, &cosa);
 
-		if (render) {
-			segs[n].x1 = cx + i2d(radius - 2 * tick) * sina;
-			segs[n].y1 = cy - i2d(radius - 2 * tick) * cosa;
-		} else {
-			segs[n].x1 = cx;
-			segs[n].y1 = cy;
-		}
+		segs[n].x1 = cx + i2d(radius - 2 * tick) * sina;
+		segs[n].y1 = cy - i2d(radius - 2 * tick) * cosa;
 		segs[n].x2 = cx + i2d(radius) * sina;
 		segs[n].y2 = cy - i2d(radius) * cosa;
 		n++;
 	}
-	gc = render ? radar->grey50_gc : radar->grey50_clip1_gc;
-	radar_draw_segments(radar, drawable, gc, pixbuf, alpha,
-			    render, segs, n);
+	radar_draw_segments(radar, drawable, radar->grey50_gc,
+			    pixbuf, alpha, render, segs, n);
 
 	n = 0;
 	for (a = 1; a < 360; a++) {
@@ -1672,20 +2151,14 @@ radar_draw_bg_pixmap(radar_t *radar, GdkDrawable *drawable,
 
 		outer_sincos(radar, a, &sina, &cosa);
 
-		if (render) {
-			segs[n].x1 = cx + i2d(radius - tick) * sina;
-			segs[n].y1 = cy - i2d(radius - tick) * cosa;
-		} else {
-			segs[n].x1 = cx;
-			segs[n].y1 = cy;
-		}
+		segs[n].x1 = cx + i2d(radius - tick) * sina;
+		segs[n].y1 = cy - i2d(radius - tick) * cosa;
 		segs[n].x2 = cx + i2d(radius) * sina;
 		segs[n].y2 = cy - i2d(radius) * cosa;
 		n++;
 	}
-	gc = render ? radar->grey50_gc : radar->grey50_clip0_gc;
-	radar_draw_segments(radar, drawable, gc, pixbuf, alpha,
-			    render, segs, n);
+	radar_draw_segments(radar, drawable, radar->grey50_gc,
+			    pixbuf, alpha, render, segs, n);
 
 	for (a = 0; a < 6; a++) {
 		r = i2d((a + 1) * step);
@@ -1703,8 +2176,13 @@ radar_draw_bg_pixmap(radar_t *radar, GdkDrawable *drawable,
 	for (a = 0; a < 360; a += 10) {
 		snprintf(text, sizeof(text), "%03u", a);
 
-		pango_layout_set_text(layout, text, strlen(text));
-		pango_layout_get_pixel_size(layout, &tw, &th);
+		label = radar_lookup_label(radar, drawable, radar->black_gc,
+					   radar->white_gc, LABEL_HALO_BOX,
+					   layout, text, FALSE);
+		if (NULL == label)
+			continue;
+		tw = label->tw;
+		th = label->th;
 
 		outer_sincos(radar, a, &sina, &cosa);
 
@@ -1714,9 +2192,9 @@ radar_draw_bg_pixmap(radar_t *radar, GdkDrawable *drawable,
 		x = cx + (radius * sina - i2d(tw) / 2.0 + ox);
 		y = cy - (radius * cosa + i2d(th) / 2.0 + oy);
 
-		radar_draw_layout(radar, drawable, radar->black_gc,
-				  radar->white_gc, pixbuf, alpha, render,
-				  x, y, tw, th, layout);
+		radar_draw_label_bitmap(radar, drawable, radar->black_gc,
+					pixbuf, alpha, render, label,
+					d2i(x), d2i(y));
 	}
 
 	for (a = 0; a < 360; a += 90) {
@@ -1736,18 +2214,25 @@ radar_draw_bg_pixmap(radar_t *radar, GdkDrawable *drawable,
 					radar_ranges[radar->rindex].digits,
 					(i2d(i) * radar->range) / 6.0);
 
-			pango_layout_set_text(layout, text, strlen(text));
-			pango_layout_get_pixel_size(layout, &tw, &th);
+			label = radar_lookup_label(radar, drawable,
+						   radar->grey50_gc,
+						   radar->white_gc,
+						   LABEL_HALO_BOX, layout,
+						   text, FALSE);
+			if (NULL == label)
+				continue;
+			tw = label->tw;
+			th = label->th;
 
 			ri = i2d(i * step);
 
 			x = cx + (ri * sina - i2d(tw) / 2.0);
 			y = cy - (ri * cosa + i2d(th) / 2.0);
 
-			radar_draw_layout(radar, drawable,
-					  radar->grey50_gc, radar->white_gc,
-					  pixbuf, alpha, render,
-					  x, y, tw, th, layout);
+			radar_draw_label_bitmap(radar, drawable,
+						radar->grey50_gc, pixbuf,
+						alpha, render, label,
+						d2i(x), d2i(y));
 		}
 	}
 }
@@ -1755,9 +2240,12 @@ radar_draw_bg_pixmap(radar_t *radar, GdkDrawable *drawable,
 static void
 radar_draw_background(radar_t *radar)
 {
+	gboolean render = radar->do_render && !radar->resize_draft;
 	vector_t *v;
 	int i;
 
+	radar->redraw_background = FALSE;
+
 	if (!radar->mapped || radar->wait_expose) {
 		radar->redraw_pending = TRUE;
 		return;
@@ -1769,11 +2257,11 @@ radar_draw_background(radar_t *radar)
 	}
 
 	radar_draw_bg_pixmap(radar, radar->pixmap, radar->backbuf, 0xff,
-			     radar->layout, radar->do_render,
+			     radar->layout, render,
 			     radar->cx, radar->cy, radar->step, radar->r,
 			     radar->w, radar->h);
 
-	if (radar->backbuf && radar->do_render) {
+	if (radar->backbuf && render) {
 		gdk_draw_rgb_32_image(radar->pixmap, radar->white_gc,
 				      0, 0, radar->w, radar->h,
 				      GDK_RGB_DITHER_NORMAL,
@@ -1785,34 +2273,166 @@ radar_draw_background(radar_t *radar)
 	gtk_widget_queue_draw_area(radar->canvas, 0, 0, radar->w, radar->h);
 }
 
+/*
+ * Uniform grid over the canvas, each cell lists the hash nodes of the
+ * visible vectors and arcs whose bbox touches it.  Primitives are
+ * moved between cells only when their bbox covers different cells.
+ */
 static void
-radar_set_vector(radar_t *radar, vector_t *v, GdkGC *gc,
-		 double x1, double y1, double x2, double y2)
+radar_spatial_remove(radar_t *radar, hash_node_t *node)
 {
-	v->is_visible = 1;
-	v->gc = gc;
+	GSList **cell;
+	int x, y;
 
-	v->x1 = x1;
-	v->y1 = y1;
-	v->x2 = x2;
-	v->y2 = y2;
+	if (!node->is_hashed)
+		return;
 
-	if (x1 < x2) {
-		v->bbox.x = d2i(x1) - 2;
-		v->bbox.width = d2i(x2 - x1) + 5;
-	} else {
-		v->bbox.x = d2i(x2) - 2;
-		v->bbox.width = d2i(x1 - x2) + 5;
+	for (y = node->y1; y <= node->y2; y++) {
+		cell = &radar->spatial_cells[y * radar->spatial_cols];
+		for (x = node->x1; x <= node->x2; x++)
+			cell[x] = g_slist_remove(cell[x], node);
 	}
-	if (y1 < y2) {
-		v->bbox.y = d2i(y1) - 2;
-		v->bbox.height = d2i(y2 - y1) + 5;
-	} else {
+
+	node->is_hashed = 0;
+}
+
+static void
+radar_spatial_insert(radar_t *radar, hash_node_t *node, GdkRectangle *bbox,
+		     int is_arc, gpointer prim)
+{
+	GSList **cell;
+	int x1, y1, x2, y2;
+	int x, y;
+
+	if (NULL == radar->spatial_cells)
+		return;
+
+	x1 = CLAMP(bbox->x / SPATIAL_CELL_SIZE, 0, radar->spatial_cols - 1);
+	y1 = CLAMP(bbox->y / SPATIAL_CELL_SIZE, 0, radar->spatial_rows - 1);
+	x2 = CLAMP((bbox->x + bbox->width) / SPATIAL_CELL_SIZE,
+		   0, radar->spatial_cols - 1);
+	y2 = CLAMP((bbox->y + bbox->height) / SPATIAL_CELL_SIZE,
+		   0, radar->spatial_rows - 1);
+
+	if (node->is_hashed) {
+		if (node->x1 == x1 && node->y1 == y1 &&
+		    node->x2 == x2 && node->y2 == y2)
+			return;
+
+		radar_spatial_remove(radar, node);
+	}
+
+	node->is_arc = is_arc;
+	node->prim = prim;
+	node->x1 = x1;
+	node->y1 = y1;
+	node->x2 = x2;
+	node->y2 = y2;
+
+	for (y = y1; y <= y2; y++) {
+		cell = &radar->spatial_cells[y * radar->spatial_cols];
+		for (x = x1; x <= x2; x++)
+			cell[x] = g_slist_prepend(cell[x], node);
+	}
+
+	node->is_hashed = 1;
+}
+
+/*
+ * Drop primitives hidden since the last frame from the grid.
+ */
+static void
+radar_spatial_prune(radar_t *radar)
+{
+	vector_t *v;
+	arc_t *a;
+	target_t *s;
+	int i, j;
+
+	for (i = 0; i < RADAR_NR_VECTORS; i++) {
+		v = &radar->vectors[i];
+
+		if (!v->is_visible)
+			radar_spatial_remove(radar, &v->node);
+	}
+
+	for (i = 0; i < RADAR_NR_TARGETS; i++) {
+		s = &radar->target[i];
+
+		for (j = 0; j < TARGET_NR_VECTORS; j++) {
+			v = &s->vectors[j];
+
+			if (!v->is_visible)
+				radar_spatial_remove(radar, &v->node);
+		}
+
+		for (j = 0; j < TARGET_NR_ARCS; j++) {
+			a = &s->arcs[j];
+
+			if (!a->is_visible)
+				radar_spatial_remove(radar, &a->node);
+		}
+	}
+}
+
+static void
+radar_spatial_resize(radar_t *radar)
+{
+	target_t *s;
+	int i, j;
+
+	for (i = 0; i < RADAR_NR_VECTORS; i++)
+		radar->vectors[i].node.is_hashed = 0;
+
+	for (i = 0; i < RADAR_NR_TARGETS; i++) {
+		s = &radar->target[i];
+
+		for (j = 0; j < TARGET_NR_VECTORS; j++)
+			s->vectors[j].node.is_hashed = 0;
+		for (j = 0; j < TARGET_NR_ARCS; j++)
+			s->arcs[j].node.is_hashed = 0;
+	}
+
+	if (radar->spatial_cells) {
+		for (i = 0; i < radar->spatial_cols * radar->spatial_rows; i++)
+			g_slist_free(radar->spatial_cells[i]);
+		g_free(radar->spatial_cells);
+	}
+
+	radar->spatial_cols = radar->w / SPATIAL_CELL_SIZE + 1;
+	radar->spatial_rows = radar->h / SPATIAL_CELL_SIZE + 1;
+	radar->spatial_cells = g_new0(GSList *, radar->spatial_cols *
+						radar->spatial_rows);
+}
+
+static void
+radar_set_vector(radar_t *radar, vector_t *v, GdkGC *gc,
+		 double x1, double y1, double x2, double y2)
+{
+	v->is_visible = 1;
+	v->gc = gc;
+
+	v->x1 = x1;
+	v->y1 = y1;
+	v->x2 = x2;
+	v->y2 = y2;
+
+	if (x1 < x2) {
+		v->bbox.x = d2i(x1) - 2;
+		v->bbox.width = d2i(x2 - x1) + 5;
+	} else {
+		v->bbox.x = d2i(x2) - 2;
+		v->bbox.width = d2i(x1 - x2) + 5;
+	}
+	if (y1 < y2) {
+		v->bbox.y = d2i(y1) - 2;
+		v->bbox.height = d2i(y2 - y1) + 5;
+	} else {
 		v->bbox.y = d2i(y2) - 2;
 		v->bbox.height = d2i(y1 - y2) + 5;
 	}
 
-	gdk_window_invalidate_rect(radar->canvas->window, &v->bbox, FALSE);
+	radar_spatial_insert(radar, &v->node, &v->bbox, 0, v);
 }
 
 static void
@@ -1834,95 +2454,152 @@ radar_set_arc(radar_t *radar, arc_t *a, GdkGC *gc,
 	a->bbox.width = d2i(2.0 * radius) + 4;
 	a->bbox.height = d2i(2.0 * radius) + 4;
 
-	gdk_window_invalidate_rect(radar->canvas->window, &a->bbox, FALSE);
+	radar_spatial_insert(radar, &a->node, &a->bbox, 1, a);
 }
 
-void
-radar_draw_arc(radar_t *radar, GdkDrawable *drawable,
-	       GdkPixbuf *pixbuf, guchar alpha, gboolean render, arc_t *a)
+/*
+ * Outline of the arc as quads of asin(2.5 / radius) each.  Points are
+ * advanced by rotating with the step, so only the start, the end and
+ * the step itself need cos() and sin().
+ */
+static int
+radar_tessellate_arc(arc_t *a, double halfwidth, GList **traps)
 {
-	GdkGCValues values;
-	GList *traps = NULL;
 	double xc, yc, radius;
 	double start, delta;
 	double angle, sign, inc;
-	double sina, cosa;
+	double sina, cosa, sini, cosi, t;
 	point_t points[4];
-	double halfwidth;
 	int err;
 
-	if (render) {
-		gdk_gc_get_values(a->gc, &values);
-		if (values.line_width == 0)
-			halfwidth = 0.5;
-		else
-			halfwidth = i2d(values.line_width) / 2.0;
+	xc = a->x;
+	yc = a->y;
+	radius = a->radius;
+
+	start = M_PI * a->angle1 / 180.0;
+	delta = M_PI * a->angle2 / 180.0;
+	if (delta < 0) {
+		sign = -1.0;
+		delta = -delta;
+	} else {
+		sign = 1.0;
+	}
 
-		xc = a->x;
-		yc = a->y;
-		radius = a->radius;
+	if (radius < 7.0) {
+		inc = M_PI / 8.0;
+	} else {
+		inc = asin(2.5 / radius);
+	}
+	cosi = cos(inc);
+	sini = sign * sin(inc);
 
-		start = M_PI * a->angle1 / 180.0;
-		delta = M_PI * a->angle2 / 180.0;
-		if (delta < 0) {
-			sign = -1.0;
-			delta = -delta;
-		} else {
-			sign = 1.0;
-		}
+	cosa = cos(start);
+	sina = sin(start);
+	points[2].x = xc + (radius + halfwidth) * cosa;
+	points[2].y = yc - (radius + halfwidth) * sina;
+	points[3].x = xc + (radius - halfwidth) * cosa;
+	points[3].y = yc - (radius - halfwidth) * sina;
 
-		if (radius < 7.0) {
-			inc = M_PI / 8.0;
-		} else {
-			inc = asin(2.5 / radius);
-		}
+	for (angle = inc; angle < delta; angle += inc) {
+		t = cosa * cosi - sina * sini;
+		sina = sina * cosi + cosa * sini;
+		cosa = t;
 
-		cosa = cos(start);
-		sina = sin(start);
+		points[0] = points[2];
+		points[1] = points[3];
 		points[2].x = xc + (radius + halfwidth) * cosa;
 		points[2].y = yc - (radius + halfwidth) * sina;
 		points[3].x = xc + (radius - halfwidth) * cosa;
 		points[3].y = yc - (radius - halfwidth) * sina;
 
-		for (angle = inc; angle < delta; angle += inc) {
-			cosa = cos(start + sign * angle);
-			sina = sin(start + sign * angle);
+		err = radar_tessellate_rectangle(points, traps);
+		if (err < 0)
+			return err;
+	}
+	cosa = cos(start + sign * delta);
+	sina = sin(start + sign * delta);
 
-			points[0] = points[2];
-			points[1] = points[3];
-			points[2].x = xc + (radius + halfwidth) * cosa;
-			points[2].y = yc - (radius + halfwidth) * sina;
-			points[3].x = xc + (radius - halfwidth) * cosa;
-			points[3].y = yc - (radius - halfwidth) * sina;
+	points[0] = points[2];
+	points[1] = points[3];
+	points[2].x = xc + (radius + halfwidth) * cosa;
+	points[2].y = yc - (radius + halfwidth) * sina;
+	points[3].x = xc + (radius - halfwidth) * cosa;
+	points[3].y = yc - (radius - halfwidth) * sina;
 
-			err = radar_tessellate_rectangle(points, &traps);
-			if (err < 0) {
-				printf("%s:%u: error %d: %s\n",
-				       __FUNCTION__, __LINE__,
-				       err, strerror(-err));
-				return;
-			}
-		}
-		cosa = cos(start + sign * delta);
-		sina = sin(start + sign * delta);
+	return radar_tessellate_rectangle(points, traps);
+}
 
-		points[0] = points[2];
-		points[1] = points[3];
-		points[2].x = xc + (radius + halfwidth) * cosa;
-		points[2].y = yc - (radius + halfwidth) * sina;
-		points[3].x = xc + (radius - halfwidth) * cosa;
-		points[3].y = yc - (radius - halfwidth) * sina;
+static void
+radar_free_traps(GList *traps)
+{
+	g_list_foreach(traps, (GFunc) free, NULL);
+	g_list_free(traps);
+}
 
-		err = radar_tessellate_rectangle(points, &traps);
-		if (err < 0) {
-			printf("%s:%u: error %d: %s\n", __FUNCTION__, __LINE__,
-			       err, strerror(-err));
+/*
+ * Tessellated arcs are kept for ARC_CACHE_SIZE different geometries,
+ * replaced round robin.  Range rings and unchanged course arcs are
+ * found here on every redraw.
+ */
+static GList *
+radar_lookup_arc(radar_t *radar, arc_t *a, double halfwidth)
+{
+	arc_tess_t *e;
+	GList *traps = NULL;
+	int i, err;
+
+	for (i = 0; i < ARC_CACHE_SIZE; i++) {
+		e = &radar->arc_cache[i];
+
+		if (e->traps && e->x == a->x && e->y == a->y &&
+		    e->radius == a->radius && e->halfwidth == halfwidth &&
+		    e->angle1 == a->angle1 && e->angle2 == a->angle2)
+			return e->traps;
+	}
+
+	err = radar_tessellate_arc(a, halfwidth, &traps);
+	if (err < 0) {
+		printf("%s:%u: error %d: %s\n", __FUNCTION__, __LINE__,
+		       err, strerror(-err));
+		radar_free_traps(traps);
+		return NULL;
+	}
+
+	e = &radar->arc_cache[radar->arc_cache_next];
+	radar->arc_cache_next = (radar->arc_cache_next + 1) % ARC_CACHE_SIZE;
+
+	radar_free_traps(e->traps);
+	e->x = a->x;
+	e->y = a->y;
+	e->radius = a->radius;
+	e->angle1 = a->angle1;
+	e->angle2 = a->angle2;
+	e->halfwidth = halfwidth;
+	e->traps = traps;
+
+	return traps;
+}
+
+void
+radar_draw_arc(radar_t *radar, GdkDrawable *drawable,
+	       GdkPixbuf *pixbuf, guchar alpha, gboolean render, arc_t *a)
+{
+	GdkGCValues values;
+	GList *traps;
+	double halfwidth;
+
+	if (render) {
+		gdk_gc_get_values(a->gc, &values);
+		if (values.line_width == 0)
+			halfwidth = 0.5;
+		else
+			halfwidth = i2d(values.line_width) / 2.0;
+
+		traps = radar_lookup_arc(radar, a, halfwidth);
+		if (NULL == traps)
 			return;
-		}
 
 		radar_draw_traps(radar, drawable, a->gc, pixbuf, alpha, &traps);
-		g_list_foreach(traps, (GFunc) free, NULL);
-		g_list_free(traps);
 	} else {
 		gdk_draw_arc(drawable, a->gc, FALSE,
 			     d2i(a->x - a->radius), d2i(a->y - a->radius),
@@ -1984,10 +2661,10 @@ radar_draw_vector(radar_t *radar, GdkDrawable *drawable, GdkPixbuf *pixbuf,
 	double dashes[2] = { 3.0, 3.0 };
 	GdkGCValues values;
 	GList *traps = NULL;
-	double width, dx, dy, a, sina, cosa;
-	double l, r1, r2, x1, y1, x2, y2;
+	trapezoid_t *dash_traps;
+	double width;
 	double vx1, vy1, vx2, vy2;
-	int w, h;
+	int w, h, n;
 	int err;
 
 	if (render) {
@@ -2005,7 +2682,10 @@ radar_draw_vector(radar_t *radar, GdkDrawable *drawable, GdkPixbuf *pixbuf,
 /*
  * Pre-clip vector here...
  */
-		if (pixbuf) {
+		if (radar->raster) {
+			w = radar->raster->width;
+			h = radar->raster->height;
+		} else if (pixbuf) {
 			w = gdk_pixbuf_get_width(pixbuf);
 			h = gdk_pixbuf_get_height(pixbuf);
 		} else {
@@ -2018,27 +2698,11 @@ radar_draw_vector(radar_t *radar, GdkDrawable *drawable, GdkPixbuf *pixbuf,
 		}
 
 		if (values.line_style == GDK_LINE_ON_OFF_DASH) {
-			dx = vx2 - vx1;
-			dy = vy2 - vy1;
-			a = atan2(dy, dx);
-			sina = sin(a);
-			cosa = cos(a);
-			l = sqrt(dx * dx + dy * dy);
-
-			for (r1 = 0.0; r1 <= l; r1 += dashes[1]) {
-				r2 = r1 + dashes[0];
-				if (r2 > l)
-					r2 = l;
-
-				x1 = vx1 + r1 * cosa;
-				y1 = vy1 + r1 * sina;
-				x2 = vx1 + r2 * cosa;
-				y2 = vy1 + r2 * sina;
-				err = radar_tessellate_line(x1, y1, x2, y2,
-							    width, &traps);
-
-				r1 += dashes[0];
-			}
+			radar_tessellate_dashes(vx1, vy1, vx2, vy2, width,
+						dashes, &dash_traps, &n);
+			radar_draw_trap_array(radar, drawable, v->gc, alpha,
+					      dash_traps, n);
+			g_free(dash_traps);
 		} else {
 			err = radar_tessellate_line(vx1, vy1, vx2, vy2,
 						    width, &traps);
@@ -2046,13 +2710,16 @@ radar_draw_vector(radar_t *radar, GdkDrawable *drawable, GdkPixbuf *pixbuf,
 				printf("%s:%u: error %d: %s\n",
 				       __FUNCTION__, __LINE__,
 				       err, strerror(-err));
+				g_list_foreach(traps, (GFunc) free, NULL);
+				g_list_free(traps);
 				return;
 			}
-		}
 
-		radar_draw_traps(radar, drawable, v->gc, pixbuf, alpha, &traps);
-		g_list_foreach(traps, (GFunc) free, NULL);
-		g_list_free(traps);
+			radar_draw_traps(radar, drawable, v->gc, pixbuf,
+					 alpha, &traps);
+			g_list_foreach(traps, (GFunc) free, NULL);
+			g_list_free(traps);
+		}
 	} else {
 		gdk_draw_line(radar->canvas->window, v->gc,
 			      d2i(v->x1), d2i(v->y1),
@@ -2328,7 +2995,7 @@ check_arc(radar_t *radar, arc_t *a, double l1, double l2,
 				double *, double *))
 {
 	double start, delta, sign, inc;
-	double angle, cosa, sina;
+	double angle, cosa, sina, cosi, sini, t;
 	vector_t v;
 
 	start = M_PI * a->angle1 / 180.0;
@@ -2340,7 +3007,10 @@ check_arc(radar_t *radar, arc_t *a, double l1, double l2,
 		sign = 1.0;
 	}
 
+	/* cos and sin of M_PI / 8 */
 	inc = M_PI / 8.0;
+	cosi = 0.92387953251128674;
+	sini = sign * 0.38268343236508978;
 
 	cosa = cos(start);
 	sina = sin(start);
@@ -2348,8 +3018,9 @@ check_arc(radar_t *radar, arc_t *a, double l1, double l2,
 	v.y2 = a->y - a->radius * sina;
 
 	for (angle = inc; angle < delta; angle += inc) {
-		cosa = cos(start + sign * angle);
-		sina = sin(start + sign * angle);
+		t = cosa * cosi - sina * sini;
+		sina = sina * cosi + cosa * sini;
+		cosa = t;
 
 		v.x1 = v.x2;
 		v.y1 = v.y2;
@@ -2375,6 +3046,70 @@ label_align(double align, double extent)
 	return -((0.5 - align) / 5.0 + (1.0 - align)) * extent;
 }
 
+/*
+ * Other primitives near the label, found through the spatial hash.
+ * Nodes already stamped by this query (the label's own target, or
+ * seen in another cell) are skipped.
+ */
+static void
+check_neighbours(radar_t *radar, text_label_t *l,
+		 double low, double high, double left, double right,
+		 double *left_bound, double *right_bound,
+		 double *low_bound, double *high_bound)
+{
+	hash_node_t *node;
+	GSList *list;
+	int x1, y1, x2, y2;
+	int x, y;
+
+	if (NULL == radar->spatial_cells)
+		return;
+
+	x1 = d2i(left - i2d(l->tw)) / SPATIAL_CELL_SIZE;
+	x2 = d2i(right + i2d(l->tw)) / SPATIAL_CELL_SIZE;
+	y1 = d2i(low - i2d(l->th)) / SPATIAL_CELL_SIZE;
+	y2 = d2i(high + i2d(l->th)) / SPATIAL_CELL_SIZE;
+
+	x1 = CLAMP(x1, 0, radar->spatial_cols - 1);
+	x2 = CLAMP(x2, 0, radar->spatial_cols - 1);
+	y1 = CLAMP(y1, 0, radar->spatial_rows - 1);
+	y2 = CLAMP(y2, 0, radar->spatial_rows - 1);
+
+	for (y = y1; y <= y2; y++) {
+		for (x = x1; x <= x2; x++) {
+			list = radar->spatial_cells[y * radar->spatial_cols + x];
+
+			for (; list; list = list->next) {
+				node = list->data;
+
+				if (node->stamp == radar->spatial_stamp)
+					continue;
+				node->stamp = radar->spatial_stamp;
+
+				if (node->is_arc) {
+					check_arc(radar, node->prim,
+						  low, high,
+						  left_bound, right_bound,
+						  check_vector_horiz);
+					check_arc(radar, node->prim,
+						  left, right,
+						  low_bound, high_bound,
+						  check_vector_vert);
+				} else {
+					check_vector_horiz(radar, node->prim,
+							   low, high,
+							   left_bound,
+							   right_bound);
+					check_vector_vert(radar, node->prim,
+							  left, right,
+							  low_bound,
+							  high_bound);
+				}
+			}
+		}
+	}
+}
+
 static void
 estimate_label_position(radar_t *radar, target_t *t, text_label_t *l)
 {
@@ -2385,6 +3120,8 @@ estimate_label_position(radar_t *radar, target_t *t, text_label_t *l)
 	arc_t *a;
 	int i;
 
+	radar->spatial_stamp++;
+
 
 	high = l->cy + i2d(l->th) / 2.0 + 1.0;
 	low = l->cy - i2d(l->th) / 2.0 - 1.0;
@@ -2405,6 +3142,7 @@ estimate_label_position(radar_t *radar, target_t *t, text_label_t *l)
 
 		if (!v->is_visible)
 			continue;
+		v->node.stamp = radar->spatial_stamp;
 
 		check_vector_horiz(radar, v, low, high,
 				   &left_bound, &right_bound);
@@ -2424,6 +3162,7 @@ estimate_label_position(radar_t *radar, target_t *t, text_label_t *l)
 
 		if (!a->is_visible)
 			continue;
+		a->node.stamp = radar->spatial_stamp;
 
 		check_arc(radar, a, low, high, &left_bound, &right_bound,
 			  check_vector_horiz);
@@ -2438,6 +3177,9 @@ estimate_label_position(radar_t *radar, target_t *t, text_label_t *l)
 #endif
 	}
 
+	check_neighbours(radar, l, low, high, left, right,
+			 &left_bound, &right_bound, &low_bound, &high_bound);
+
 	left = l->cx - left_bound;
 	right = right_bound - l->cx;
 	low = l->cy - low_bound;
@@ -2504,8 +3246,18 @@ static void
 radar_set_label(radar_t *radar, target_t *t, text_label_t *l, GdkGC *fg, GdkGC *bg,
 		double x, double y, char *markup, size_t len)
 {
-	pango_layout_set_markup(l->layout, markup, len);
-	pango_layout_get_pixel_size(l->layout, (int *) &l->tw, (int *) &l->th);
+	label_bitmap_t *label;
+
+	label = radar_lookup_label(radar, radar->canvas->window, fg, bg,
+				   LABEL_HALO_CROSS, l->layout, markup, TRUE);
+	if (label) {
+		l->tw = label->tw;
+		l->th = label->th;
+	} else {
+		pango_layout_set_markup(l->layout, markup, len);
+		pango_layout_get_pixel_size(l->layout,
+					    (int *) &l->tw, (int *) &l->th);
+	}
 
 	l->cx = x;
 	l->cy = y;
@@ -2531,42 +3283,78 @@ radar_set_label(radar_t *radar, target_t *t, text_label_t *l, GdkGC *fg, GdkGC *
 	l->bbox.width = l->tw + 2;
 	l->bbox.height = l->th + 2;
 
-	if (l->markup)
-		free(l->markup);
-	l->markup = strdup(markup);
-
-	gdk_window_invalidate_rect(radar->canvas->window, &l->bbox, FALSE);
+	if (NULL == l->markup || strcmp(l->markup, markup)) {
+		if (l->markup)
+			free(l->markup);
+		l->markup = strdup(markup);
+	}
 }
 
 void
 radar_draw_label(radar_t *radar, GdkDrawable *drawable, GdkPixbuf *pixbuf,
 		 guchar alpha, gboolean render, text_label_t *l)
 {
-	gdk_draw_layout(drawable, l->bg,
-			l->cx + l->xoff + label_align(l->xalign, i2d(l->tw)) + 1,
-			l->cy + l->yoff + label_align(l->yalign, i2d(l->th)) + 0,
-			l->layout);
-	gdk_draw_layout(drawable, l->bg,
-			l->cx + l->xoff + label_align(l->xalign, i2d(l->tw)) - 1,
-			l->cy + l->yoff + label_align(l->yalign, i2d(l->th)) + 0,
-			l->layout);
-	gdk_draw_layout(drawable, l->bg,
-			l->cx + l->xoff + label_align(l->xalign, i2d(l->tw)) + 0,
-			l->cy + l->yoff + label_align(l->yalign, i2d(l->th)) + 1,
-			l->layout);
-	gdk_draw_layout(drawable, l->bg,
-			l->cx + l->xoff + label_align(l->xalign, i2d(l->tw)) + 0,
-			l->cy + l->yoff + label_align(l->yalign, i2d(l->th)) - 1,
-			l->layout);
-
-	gdk_draw_layout(drawable, l->fg,
-			l->cx + l->xoff + label_align(l->xalign, i2d(l->tw)),
-			l->cy + l->yoff + label_align(l->yalign, i2d(l->th)),
-			l->layout);
+	label_bitmap_t *label;
+
+	label = radar_lookup_label(radar, drawable, l->fg, l->bg,
+				   LABEL_HALO_CROSS, l->layout, l->markup, TRUE);
+	if (NULL == label)
+		return;
+
+	radar_draw_label_bitmap(radar, drawable, l->fg, pixbuf, alpha, render,
+				label,
+				l->cx + l->xoff + label_align(l->xalign, i2d(l->tw)),
+				l->cy + l->yoff + label_align(l->yalign, i2d(l->th)));
+}
+
+/*
+ * Flat list of the visible primitives in drawing order, with the GC
+ * state each one needs resolved once into a style table.  Rebuilt
+ * after every recompute, and walked by the screen, image and PDF
+ * output alike.
+ */
+static int
+radar_display_style(radar_t *radar, GdkGC *gc)
+{
+	display_style_t *style;
+	GdkGCValues values;
+	int i;
+
+	for (i = 0; i < radar->display_styles->len; i++) {
+		style = &g_array_index(radar->display_styles,
+				       display_style_t, i);
+		if (style->gc == gc)
+			return i;
+	}
+
+	gdk_gc_get_values(gc, &values);
+
+	g_array_set_size(radar->display_styles, i + 1);
+	style = &g_array_index(radar->display_styles, display_style_t, i);
+	style->gc = gc;
+	style->rgb = radar_gc_rgb(gc);
+	style->line_width = values.line_width;
+	style->line_style = values.line_style;
+
+	return i;
+}
+
+static void
+radar_display_add(radar_t *radar, int type, int is_target, GdkGC *gc,
+		  gpointer prim)
+{
+	display_item_t item;
+
+	item.type = type;
+	item.style = radar_display_style(radar, gc);
+	item.is_target = is_target;
+	item.prim = prim;
+
+	g_array_append_val(radar->display_list, item);
 }
 
 static void
-radar_draw_vectors(radar_t *radar)
+radar_build_display_list(radar_t *radar)
 {
 	vector_t *v;
 	poly_t *p;
@@ -2575,26 +3363,13 @@ radar_draw_vectors(radar_t *radar)
 	target_t *s;
 	int i, j;
 
-	if (radar->forebuf && radar->do_render) {
-		guchar *dst, *src;
-
-		dst = gdk_pixbuf_get_pixels(radar->forebuf);
-		src = gdk_pixbuf_get_pixels(radar->backbuf);
-		for (i = 0; i < radar->h; i++) {
-			memcpy(dst, src, 4 * radar->w);
-			dst += gdk_pixbuf_get_rowstride(radar->forebuf);
-			src += gdk_pixbuf_get_rowstride(radar->backbuf);
-		}
-	}
+	g_array_set_size(radar->display_list, 0);
+	g_array_set_size(radar->display_styles, 0);
 
 	for (i = 0; i < RADAR_NR_VECTORS; i++) {
 		v = &radar->vectors[i];
-
-		if (!v->is_visible)
-			continue;
-
-		radar_draw_vector(radar, radar->canvas->window,
-				  radar->forebuf, 0xff, radar->do_render, v);
+		if (v->is_visible)
+			radar_display_add(radar, DISPLAY_VECTOR, 0, v->gc, v);
 	}
 
 	for (i = 0; i < RADAR_NR_TARGETS; i++) {
@@ -2602,50 +3377,178 @@ radar_draw_vectors(radar_t *radar)
 
 		for (j = 0; j < TARGET_NR_VECTORS; j++) {
 			v = &s->vectors[j];
-
-			if (!v->is_visible)
-				continue;
-
-			radar_draw_vector(radar, radar->canvas->window,
-					  radar->forebuf, 0xff,
-					  radar->do_render, v);
+			if (v->is_visible)
+				radar_display_add(radar, DISPLAY_VECTOR, 1,
+						  v->gc, v);
 		}
 
 		for (j = 0; j < TARGET_NR_ARCS; j++) {
 			a = &s->arcs[j];
-
-			if (!a->is_visible)
-				continue;
-
-			radar_draw_arc(radar, radar->canvas->window,
-				       radar->forebuf, 0xff,
-				       radar->do_render, a);
+			if (a->is_visible)
+				radar_display_add(radar, DISPLAY_ARC, 1,
+						  a->gc, a);
 		}
 
 		for (j = 0; j < TARGET_NR_POLYS; j++) {
 			p = &s->polys[j];
-
-			if (!p->is_visible)
-				continue;
-
-			radar_draw_poly(radar, radar->canvas->window,
-					radar->forebuf, 0xff,
-					radar->do_render, p);
+			if (p->is_visible)
+				radar_display_add(radar, DISPLAY_POLY, 1,
+						  p->gc, p);
 		}
 
 		for (j = 0; j < TARGET_NR_LABELS; j++) {
 			l = &s->labels[j];
+			if (l->is_visible)
+				radar_display_add(radar, DISPLAY_LABEL, 1,
+						  l->fg, l);
+		}
+	}
+}
 
-			if (!l->is_visible)
-				continue;
+static void
+radar_display_point(radar_t *radar, const display_xform_t *xf,
+		    double x1, double y1, double *x2, double *y2)
+{
+	double scale = ((double) xf->r) / ((double) radar->r);
+
+	*x2 = xf->cx + (x1 - radar->cx) * scale;
+	*y2 = xf->cy + (y1 - radar->cy) * scale;
+}
+
+static double
+radar_display_length(radar_t *radar, const display_xform_t *xf, double l)
+{
+	return l * ((double) xf->r) / ((double) radar->r);
+}
+
+/*
+ * Draw the display list, as is on the screen, or mapped by xf.
+ */
+void
+radar_draw_display_list(radar_t *radar, GdkDrawable *drawable,
+			GdkPixbuf *pixbuf, guchar alpha, gboolean render,
+			const display_xform_t *xf)
+{
+	display_item_t *item;
+	vector_t *v, tvec;
+	arc_t *a, tarc;
+	poly_t *p, tpoly;
+	text_label_t *l, tlabel;
+	int i, k;
+
+	for (i = 0; i < radar->display_list->len; i++) {
+		item = &g_array_index(radar->display_list, display_item_t, i);
+
+		switch (item->type) {
+		case DISPLAY_VECTOR:
+			v = item->prim;
+			if (xf) {
+				tvec.gc = v->gc;
+				radar_display_point(radar, xf, v->x1, v->y1,
+						    &tvec.x1, &tvec.y1);
+				radar_display_point(radar, xf, v->x2, v->y2,
+						    &tvec.x2, &tvec.y2);
+				v = &tvec;
+			}
+
+			radar_draw_vector(radar, drawable, pixbuf, alpha,
+					  render, v);
+			break;
+
+		case DISPLAY_ARC:
+			a = item->prim;
+			if (xf) {
+				tarc.gc = a->gc;
+				tarc.angle1 = a->angle1;
+				tarc.angle2 = a->angle2;
+				radar_display_point(radar, xf, a->x, a->y,
+						    &tarc.x, &tarc.y);
+				tarc.radius = radar_display_length(radar, xf,
+								   a->radius);
+				a = &tarc;
+			}
+
+			radar_draw_arc(radar, drawable, pixbuf, alpha,
+				       render, a);
+			break;
+
+		case DISPLAY_POLY:
+			p = item->prim;
+			if (xf) {
+				tpoly.gc = p->gc;
+				tpoly.npoints = p->npoints;
+				for (k = 0; k < p->npoints; k++)
+					radar_display_point(radar, xf,
+						p->points[k].x, p->points[k].y,
+						&tpoly.points[k].x,
+						&tpoly.points[k].y);
+				p = &tpoly;
+			}
+
+			radar_draw_poly(radar, drawable, pixbuf, alpha,
+					render, p);
+			break;
+
+		case DISPLAY_LABEL:
+			l = item->prim;
+			if (NULL == xf) {
+				radar_draw_label(radar, drawable, pixbuf,
+						 alpha, render, l);
+				break;
+			}
+
+			tlabel.fg = l->fg;
+			tlabel.bg = l->bg;
+			tlabel.xalign = l->xalign;
+			tlabel.yalign = l->yalign;
+			tlabel.markup = l->markup;
+
+			tlabel.layout = pango_layout_new(xf->context);
+			pango_layout_set_alignment(tlabel.layout,
+				pango_layout_get_alignment(l->layout));
+			pango_layout_set_font_description(tlabel.layout,
+							  xf->font);
+			pango_layout_set_markup(tlabel.layout, l->markup, -1);
+			pango_layout_get_pixel_size(tlabel.layout,
+						    (int *) &tlabel.tw,
+						    (int *) &tlabel.th);
+
+			radar_display_point(radar, xf, l->cx, l->cy,
+					    &tlabel.cx, &tlabel.cy);
+			tlabel.xoff = radar_display_length(radar, xf, l->xoff);
+			tlabel.yoff = radar_display_length(radar, xf, l->yoff);
+
+			radar_draw_label(radar, drawable, pixbuf, alpha,
+					 render, &tlabel);
+
+			g_object_unref(tlabel.layout);
+			break;
+		}
+	}
+}
+
+static void
+radar_draw_vectors(radar_t *radar)
+{
+	gboolean render = radar->do_render && !radar->resize_draft;
+	int i;
+
+	if (radar->forebuf && render) {
+		guchar *dst, *src;
 
-			radar_draw_label(radar, radar->canvas->window,
-					 radar->forebuf, 0xff,
-					 radar->do_render, l);
+		dst = gdk_pixbuf_get_pixels(radar->forebuf);
+		src = gdk_pixbuf_get_pixels(radar->backbuf);
+		for (i = 0; i < radar->h; i++) {
+			memcpy(dst, src, 4 * radar->w);
+			dst += gdk_pixbuf_get_rowstride(radar->forebuf);
+			src += gdk_pixbuf_get_rowstride(radar->backbuf);
 		}
 	}
 
-	if (radar->forebuf && radar->do_render) {
+	radar_draw_display_list(radar, radar->canvas->window,
+				radar->forebuf, 0xff, render, NULL);
+
+	if (radar->forebuf && render) {
 		gdk_draw_pixbuf(radar->canvas->window, radar->white_gc,
 				radar->forebuf, 0, 0, 0, 0, radar->w, radar->h,
 				GDK_RGB_DITHER_NORMAL, 0, 0);
@@ -3964,8 +4867,6 @@ radar_mark_vector(radar_t *radar, target_t *s, enum target_vector_number type,
 		p->bbox.width = 14;
 		p->bbox.height = 14;
 
-		gdk_window_invalidate_rect(radar->canvas->window,
-					   &p->bbox, FALSE);
 
 		if (type != VECTOR_RELATIVE)
 			break;
@@ -4000,8 +4901,6 @@ radar_mark_vector(radar_t *radar, target_t *s, enum target_vector_number type,
 		p->bbox.width = 20;
 		p->bbox.height = 20;
 
-		gdk_window_invalidate_rect(radar->canvas->window,
-					   &p->bbox, FALSE);
 
 		p = p + 1;
 
@@ -4027,8 +4926,6 @@ radar_mark_vector(radar_t *radar, target_t *s, enum target_vector_number type,
 		p->bbox.width = 20;
 		p->bbox.height = 20;
 
-		gdk_window_invalidate_rect(radar->canvas->window,
-					   &p->bbox, FALSE);
 
 		break;
 	default:
@@ -4036,6 +4933,344 @@ radar_mark_vector(radar_t *radar, target_t *s, enum target_vector_number type,
 	}
 }
 
+/*
+ * Scene diffing: primitives live in fixed slots, each remembers its
+ * bbox and a hash of geometry and style from the previous frame.
+ * Only slots that appeared, disappeared or changed get invalidated.
+ */
+static guint32
+radar_scene_hash(guint32 hash, const void *data, size_t len)
+{
+	const guchar *p = data;
+
+	while (len--) {
+		hash ^= *p++;
+		hash *= 16777619;
+	}
+
+	return hash;
+}
+
+static guint32
+radar_scene_hash_vector(vector_t *v)
+{
+	guint32 hash = 2166136261U;
+
+	hash = radar_scene_hash(hash, &v->gc, sizeof(v->gc));
+	hash = radar_scene_hash(hash, &v->x1, sizeof(v->x1));
+	hash = radar_scene_hash(hash, &v->y1, sizeof(v->y1));
+	hash = radar_scene_hash(hash, &v->x2, sizeof(v->x2));
+	hash = radar_scene_hash(hash, &v->y2, sizeof(v->y2));
+
+	return hash | 1;
+}
+
+static guint32
+radar_scene_hash_arc(arc_t *a)
+{
+	guint32 hash = 2166136261U;
+
+	hash = radar_scene_hash(hash, &a->gc, sizeof(a->gc));
+	hash = radar_scene_hash(hash, &a->x, sizeof(a->x));
+	hash = radar_scene_hash(hash, &a->y, sizeof(a->y));
+	hash = radar_scene_hash(hash, &a->radius, sizeof(a->radius));
+	hash = radar_scene_hash(hash, &a->angle1, sizeof(a->angle1));
+	hash = radar_scene_hash(hash, &a->angle2, sizeof(a->angle2));
+
+	return hash | 1;
+}
+
+static guint32
+radar_scene_hash_poly(poly_t *p)
+{
+	guint32 hash = 2166136261U;
+
+	hash = radar_scene_hash(hash, &p->gc, sizeof(p->gc));
+	hash = radar_scene_hash(hash, p->points,
+				p->npoints * sizeof(point_t));
+
+	return hash | 1;
+}
+
+static guint32
+radar_scene_hash_label(text_label_t *l)
+{
+	guint32 hash = 2166136261U;
+
+	hash = radar_scene_hash(hash, &l->fg, sizeof(l->fg));
+	hash = radar_scene_hash(hash, &l->bg, sizeof(l->bg));
+	hash = radar_scene_hash(hash, &l->bbox, sizeof(l->bbox));
+	if (l->markup)
+		hash = radar_scene_hash(hash, l->markup, strlen(l->markup));
+
+	return hash | 1;
+}
+
+static void
+radar_scene_mark(scene_slot_t *slot, int *is_visible, GdkRectangle *bbox)
+{
+	slot->was_visible = *is_visible;
+	slot->bbox = *bbox;
+	*is_visible = 0;
+}
+
+/*
+ * With the render thread, the screen keeps showing the last finished
+ * frame: damage is collected until the frame now recorded comes back.
+ */
+static gboolean
+radar_use_render_thread(radar_t *radar)
+{
+	return radar->render_worker && radar->do_render &&
+	       !radar->resize_draft;
+}
+
+static void
+radar_invalidate_rect(radar_t *radar, GdkRectangle *rect)
+{
+	if (radar_use_render_thread(radar))
+		gdk_region_union_with_rect(radar->frame_damage, rect);
+	else
+		gdk_window_invalidate_rect(radar->canvas->window, rect, FALSE);
+}
+
+static gboolean
+radar_frame_ready(gpointer user_data)
+{
+	radar_t *radar = user_data;
+	raster_frame_t *frame;
+
+	frame = raster_worker_take(radar->render_worker);
+	if (NULL == frame)
+		return FALSE;
+
+	if (radar->frame)
+		g_object_unref(radar->frame);
+	radar->frame = frame->pixbuf;
+	frame->pixbuf = NULL;
+
+	gdk_window_invalidate_region(radar->canvas->window,
+				     radar->frame_damage, FALSE);
+	if (frame->seq == radar->frame_seq) {
+		gdk_region_destroy(radar->frame_damage);
+		radar->frame_damage = gdk_region_new();
+	}
+
+	raster_frame_free(frame);
+	return FALSE;
+}
+
+/*
+ * Record the display list and hand it to the render thread.
+ */
+static void
+radar_submit_frame(radar_t *radar)
+{
+	raster_frame_t *frame;
+
+	frame = g_new0(raster_frame_t, 1);
+	frame->raster = raster_new(radar->w, radar->h);
+	frame->seq = ++radar->frame_seq;
+
+	radar->raster = frame->raster;
+	radar_draw_display_list(radar, NULL, NULL, 0xff, TRUE, NULL);
+	radar->raster = NULL;
+
+	raster_worker_submit(radar->render_worker, frame);
+}
+
+static void
+radar_scene_update(radar_t *radar, scene_slot_t *slot, int is_visible,
+		   GdkRectangle *bbox, guint32 hash)
+{
+	if (!is_visible)
+		hash = 0;
+
+	if (hash != slot->hash) {
+		if (slot->was_visible)
+			radar_invalidate_rect(radar, &slot->bbox);
+		if (is_visible)
+			radar_invalidate_rect(radar, bbox);
+	}
+
+	slot->hash = hash;
+}
+
+static void
+radar_scene_begin(radar_t *radar)
+{
+	target_t *s;
+	int i, j;
+
+	for (i = 0; i < RADAR_NR_VECTORS; i++)
+		radar_scene_mark(&radar->vectors[i].slot,
+				 &radar->vectors[i].is_visible,
+				 &radar->vectors[i].bbox);
+
+	for (i = 0; i < RADAR_NR_TARGETS; i++) {
+		s = &radar->target[i];
+
+		for (j = 0; j < TARGET_NR_VECTORS; j++)
+			radar_scene_mark(&s->vectors[j].slot,
+					 &s->vectors[j].is_visible,
+					 &s->vectors[j].bbox);
+		for (j = 0; j < TARGET_NR_ARCS; j++)
+			radar_scene_mark(&s->arcs[j].slot,
+					 &s->arcs[j].is_visible,
+					 &s->arcs[j].bbox);
+		for (j = 0; j < TARGET_NR_POLYS; j++)
+			radar_scene_mark(&s->polys[j].slot,
+					 &s->polys[j].is_visible,
+					 &s->polys[j].bbox);
+		for (j = 0; j < TARGET_NR_LABELS; j++)
+			radar_scene_mark(&s->labels[j].slot,
+					 &s->labels[j].is_visible,
+					 &s->labels[j].bbox);
+	}
+}
+
+static void
+radar_scene_commit(radar_t *radar)
+{
+	vector_t *v;
+	poly_t *p;
+	arc_t *a;
+	text_label_t *l;
+	target_t *s;
+	int i, j;
+
+	for (i = 0; i < RADAR_NR_VECTORS; i++) {
+		v = &radar->vectors[i];
+		radar_scene_update(radar, &v->slot, v->is_visible, &v->bbox,
+				   radar_scene_hash_vector(v));
+	}
+
+	for (i = 0; i < RADAR_NR_TARGETS; i++) {
+		s = &radar->target[i];
+
+		for (j = 0; j < TARGET_NR_VECTORS; j++) {
+			v = &s->vectors[j];
+			radar_scene_update(radar, &v->slot, v->is_visible,
+					   &v->bbox, radar_scene_hash_vector(v));
+		}
+		for (j = 0; j < TARGET_NR_ARCS; j++) {
+			a = &s->arcs[j];
+			radar_scene_update(radar, &a->slot, a->is_visible,
+					   &a->bbox, radar_scene_hash_arc(a));
+		}
+		for (j = 0; j < TARGET_NR_POLYS; j++) {
+			p = &s->polys[j];
+			radar_scene_update(radar, &p->slot, p->is_visible,
+					   &p->bbox, radar_scene_hash_poly(p));
+		}
+		for (j = 0; j < TARGET_NR_LABELS; j++) {
+			l = &s->labels[j];
+			radar_scene_update(radar, &l->slot, l->is_visible,
+					   &l->bbox, radar_scene_hash_label(l));
+		}
+	}
+}
+
+/*
+ * Clock minutes difference a - b, folded into [-720, 720).
+ */
+static double
+radar_play_minutes(double a, double b)
+{
+	double t;
+
+	t = fmod(a - b, 1440.0);
+	if (t < -720.0)
+		t += 1440.0;
+	else if (t >= 720.0)
+		t -= 1440.0;
+	return t;
+}
+
+static gboolean
+radar_play_active(radar_t *radar)
+{
+	return radar->playing || radar->play_time > 0.0;
+}
+
+/*
+ * Play time starts at the last sighting of the maneuvering target,
+ * or of the first target plotted if that one is empty.
+ */
+static void
+radar_play_set_base(radar_t *radar)
+{
+	target_t *s;
+	int i;
+
+	s = &radar->target[radar->mtarget];
+	if (s->distance[1] != 0.0) {
+		radar->play_base = s->time[1];
+		return;
+	}
+
+	for (i = 0; i < RADAR_NR_TARGETS; i++) {
+		s = &radar->target[i];
+		if (s->distance[1] != 0.0) {
+			radar->play_base = s->time[1];
+			return;
+		}
+	}
+
+	radar->play_base = 0.0;
+}
+
+/*
+ * Relative position of a target at play time: along the relative
+ * track from the second sighting, and along the new relative track
+ * from mpoint once the planned maneuver is due.  Own ship stays at
+ * the center.
+ */
+static gboolean
+radar_play_position(radar_t *radar, target_t *s, vector_xy_t *p)
+{
+	vector_xy_t v;
+	double t, tm, d;
+	int delta_time;
+
+	if (s->distance[0] == 0.0 || s->distance[1] == 0.0)
+		return FALSE;
+
+	delta_time = s->time[1] - s->time[0];
+	if (delta_time < 0)
+		delta_time = 1440 + s->time[1] - s->time[0];
+	if (delta_time == 0)
+		return FALSE;
+
+	t = radar_play_minutes(radar->play_base + radar->play_time,
+			       s->time[1]);
+
+	if (s->have_mpoint && s->have_new_cpa) {
+		tm = radar_play_minutes(radar->exact_mtime, s->time[1]);
+
+		if (t > tm) {
+			v.x = s->sight[1].x - s->xpoint.x;
+			v.y = s->sight[1].y - s->xpoint.y;
+
+			d = sqrt(v.x * v.x + v.y * v.y);
+			if (d < EPSILON) {
+				*p = s->mpoint;
+				return TRUE;
+			}
+
+			d = s->new_vBr * (t - tm) / (60.0 * d);
+			p->x = s->mpoint.x + v.x * d;
+			p->y = s->mpoint.y + v.y * d;
+			return TRUE;
+		}
+	}
+
+	d = t / ((double) delta_time);
+	p->x = s->sight[1].x + (s->sight[1].x - s->sight[0].x) * d;
+	p->y = s->sight[1].y + (s->sight[1].y - s->sight[0].y) * d;
+	return TRUE;
+}
+
 static void
 radar_draw_foreground(radar_t *radar)
 {
@@ -4047,12 +5282,8 @@ radar_draw_foreground(radar_t *radar)
 	double r, d, crs;
 	double xs[2], ys[2];
 	double x, y, x2, y2;
-	char text[32];
-	int delta_time;
-	vector_t *v;
-	poly_t *p;
-	arc_t *a;
-	text_label_t *l;
+	char text[32];
+	int delta_time;
 	target_t *s;
 	int i, j;
 
@@ -4062,65 +5293,26 @@ radar_draw_foreground(radar_t *radar)
 	if (!radar->mapped)
 		return;
 
-	for (i = 0; i < RADAR_NR_VECTORS; i++) {
-		v = &radar->vectors[i];
-
-		if (!v->is_visible)
-			continue;
-
-		gdk_window_invalidate_rect(radar->canvas->window,
-					   &v->bbox, TRUE);
-		v->is_visible = 0;
+	if (radar->redraw_source) {
+		g_source_remove(radar->redraw_source);
+		radar->redraw_source = 0;
 	}
+	g_get_current_time(&radar->redraw_time);
 
-	for (i = 0; i < RADAR_NR_TARGETS; i++) {
-		s = &radar->target[i];
-
-		for (j = 0; j < TARGET_NR_ARCS; j++) {
-			a = &s->arcs[j];
-
-			if (!a->is_visible)
-				continue;
-
-			gdk_window_invalidate_rect(radar->canvas->window,
-						   &a->bbox, TRUE);
-			a->is_visible = 0;
-		}
-
-		for (j = 0; j < TARGET_NR_POLYS; j++) {
-			p = &s->polys[j];
-
-			if (!p->is_visible)
-				continue;
-
-			gdk_window_invalidate_rect(radar->canvas->window,
-						   &p->bbox, TRUE);
-			p->is_visible = 0;
-		}
-
-		for (j = 0; j < TARGET_NR_VECTORS; j++) {
-			v = &s->vectors[j];
-
-			if (!v->is_visible)
-				continue;
-
-			gdk_window_invalidate_rect(radar->canvas->window,
-						   &v->bbox, TRUE);
-			v->is_visible = 0;
-		}
-
-		for (j = 0; j < TARGET_NR_LABELS; j++) {
-			l = &s->labels[j];
-
-			if (!l->is_visible)
-				continue;
+#ifdef DEBUG_REDRAW
+	printf("%s: %lu requests, %lu coalesced\n", __FUNCTION__,
+	       radar->redraw_requests, radar->redraw_coalesced);
+#endif
 
-			gdk_window_invalidate_rect(radar->canvas->window,
-						   &l->bbox, TRUE);
-			l->is_visible = 0;
-		}
+	if (radar->redraw_background) {
+		gdk_window_set_cursor(radar->window->window,
+				      radar->busy_cursor);
+		radar_draw_background(radar);
+		gdk_window_set_cursor(radar->window->window, NULL);
 	}
 
+	radar_scene_begin(radar);
+
 	if (radar->show_heading) {
 		radar_sincos(radar, radar->own_course, &sina, &cosa);
 
@@ -4382,11 +5574,52 @@ radar_draw_foreground(radar_t *radar)
 
 			}
 		}
+	}
+
+	d = radar->play_base;
+	radar_play_set_base(radar);
+	if (radar->play_base != d)
+		gtk_widget_queue_draw(GTK_WIDGET(radar->play_scale));
+
+	for (i = 0; i < RADAR_NR_TARGETS; i++) {
+		s = &radar->target[i];
+
+		s->have_play = radar_play_active(radar) &&
+			       radar_play_position(radar, s, &s->play);
+		if (!s->have_play)
+			continue;
+
+		x = radar->cx + i2d(radar->r) * s->play.x / radar->range;
+		y = radar->cy - i2d(radar->r) * s->play.y / radar->range;
+
+		radar_set_vector(radar, &s->vectors[VECTOR_PLAY_RANGE],
+				 s->ext_dash_gc, radar->cx, radar->cy, x, y);
+		radar_set_vector(radar, &s->vectors[VECTOR_PLAYX],
+				 s->cpa_gc, x - 6, y, x + 6, y);
+		radar_set_vector(radar, &s->vectors[VECTOR_PLAYY],
+				 s->cpa_gc, x, y - 6, x, y + 6);
+	}
+
+	/*
+	 * Place labels once all geometry is known, so they can be moved
+	 * off the lines of other targets as well.
+	 */
+	radar_spatial_prune(radar);
+
+	for (i = 0; i < RADAR_NR_TARGETS; i++) {
+		s = &radar->target[i];
 
 		for (j = 0; j < 2; j++) {
 			if (0.0 == s->distance[j])
 				continue;
 
+			radar_sincos(radar, s->rakrp[j], &sins[j], &coss[j]);
+
+			r = i2d(radar->r) * s->distance[j] / radar->range;
+
+			xs[j] = radar->cx + r * sins[j];
+			ys[j] = radar->cy - r * coss[j];
+
 			snprintf(text, sizeof(text), "%c<sub>%02u%02u</sub>",
 				'B' + s->index,
 				s->time[j] / 60, s->time[j] % 60);
@@ -4395,39 +5628,239 @@ radar_draw_foreground(radar_t *radar)
 					s->pos_gc, radar->white_gc,
 					xs[j], ys[j], text, strlen(text));
 		}
+
+		if (s->have_play) {
+			x = radar->cx + i2d(radar->r) * s->play.x / radar->range;
+			y = radar->cy - i2d(radar->r) * s->play.y / radar->range;
+
+			snprintf(text, sizeof(text), "%c<sub>%.2f</sub>",
+				 'B' + s->index,
+				 distance(radar, &vector_xy_null, &s->play));
+
+			radar_set_label(radar, s, &s->labels[LABEL_PLAY],
+					s->cpa_gc, radar->white_gc,
+					x, y, text, strlen(text));
+		}
 	}
+
+	radar_scene_commit(radar);
+	radar_build_display_list(radar);
+
+	if (radar_use_render_thread(radar))
+		radar_submit_frame(radar);
 }
 
-static GdkBitmap *
-radar_create_clip_mask(double cx, double cy, int w, int h, int ri, int ro)
+static gboolean
+radar_redraw_timeout(gpointer user_data)
 {
-	GdkBitmap *bitmap;
-	GdkColor color;
-	GdkGC *gc;
+	radar_t *radar = user_data;
+	double t;
 
-	bitmap = gdk_pixmap_new(NULL, w, h, 1);
-	gc = gdk_gc_new(bitmap);
-	gdk_gc_set_line_attributes(gc, 0, GDK_LINE_SOLID,
-				   GDK_CAP_ROUND, GDK_JOIN_ROUND);
+	radar->redraw_source = 0;
+
+	if (radar->playing) {
+		t = g_timer_elapsed(radar->play_timer, NULL);
+		radar_draw_foreground(radar);
+		radar->play_draw_time += g_timer_elapsed(radar->play_timer,
+							 NULL) - t;
+		radar->play_frames++;
+		return FALSE;
+	}
+
+	radar_draw_foreground(radar);
+	return FALSE;
+}
+
+/*
+ * Mark the plot dirty.  All changes up to the next frame are folded
+ * into one recompute and repaint, and frames are at least 1/max_fps
+ * apart.
+ */
+static void
+radar_schedule_redraw(radar_t *radar, gboolean background)
+{
+	GTimeVal now;
+	glong elapsed, interval;
+
+	if (background)
+		radar->redraw_background = TRUE;
+
+	if (radar->change_level > 1)
+		return;
+
+	radar->redraw_requests++;
+
+	if (radar->redraw_source) {
+		radar->redraw_coalesced++;
+		return;
+	}
+
+	interval = 1000 / radar->max_fps;
+
+	g_get_current_time(&now);
+	elapsed = (now.tv_sec - radar->redraw_time.tv_sec) * 1000 +
+		  (now.tv_usec - radar->redraw_time.tv_usec) / 1000;
+
+	if (elapsed < 0 || elapsed >= interval)
+		radar->redraw_source = g_idle_add_full(G_PRIORITY_HIGH_IDLE + 10,
+						       radar_redraw_timeout,
+						       radar, NULL);
+	else
+		radar->redraw_source = g_timeout_add_full(G_PRIORITY_HIGH_IDLE + 10,
+							  interval - elapsed,
+							  radar_redraw_timeout,
+							  radar, NULL);
+}
+
+void
+radar_flush_redraw(radar_t *radar)
+{
+	if (radar->redraw_source)
+		radar_draw_foreground(radar);
+}
+
+/*
+ * Advance play time by the real time since the last tick.  Frames
+ * are still paced by radar_schedule_redraw().
+ */
+static gboolean
+radar_play_tick(gpointer user_data)
+{
+	radar_t *radar = user_data;
+	double now, t;
+
+	now = g_timer_elapsed(radar->play_timer, NULL);
+	t = radar->play_time + (now - radar->play_last) * RADAR_PLAY_RATE;
+	radar->play_last = now;
+
+#ifdef DEBUG_PLAY
+	if (now - radar->play_stat >= 1.0) {
+		printf("%s: %.1f fps, %.2f ms per frame\n", __FUNCTION__,
+		       radar->play_frames / (now - radar->play_stat),
+		       radar->play_frames ?
+		       1000.0 * radar->play_draw_time / radar->play_frames : 0.0);
+		radar->play_stat = now;
+		radar->play_frames = 0;
+		radar->play_draw_time = 0.0;
+	}
+#endif
+
+	if (t < RADAR_PLAY_MINUTES) {
+		gtk_range_set_value(radar->play_scale, t);
+		return TRUE;
+	}
+
+	radar->play_source = 0;
+	gtk_range_set_value(radar->play_scale, RADAR_PLAY_MINUTES);
+	gtk_toggle_button_set_active(radar->play_toggle, FALSE);
+	return FALSE;
+}
+
+static void
+play_toggled(GtkToggleButton *button, gpointer user_data)
+{
+	radar_t *radar = user_data;
+
+	if (radar->play_source) {
+		g_source_remove(radar->play_source);
+		radar->play_source = 0;
+	}
 
-	color.pixel = 0;
-	gdk_gc_set_foreground(gc, &color);
-	gdk_draw_rectangle(bitmap, gc, TRUE, 0, 0, w, h);
+	radar->playing = gtk_toggle_button_get_active(button);
+	if (radar->playing) {
+		if (radar->play_time >= RADAR_PLAY_MINUTES)
+			gtk_range_set_value(radar->play_scale, 0.0);
 
-	color.pixel = 1;
-	gdk_gc_set_foreground(gc, &color);
-	gdk_draw_arc(bitmap, gc, TRUE,
-		     d2i(cx - i2d(ro)), d2i(cy - i2d(ro)),
-		     d2i(2.0 * i2d(ro)), d2i(2.0 * i2d(ro)), 0, 360 * 64);
+		g_timer_start(radar->play_timer);
+		radar->play_last = 0.0;
+		radar->play_stat = 0.0;
+		radar->play_frames = 0;
+		radar->play_draw_time = 0.0;
 
-	color.pixel = 0;
-	gdk_gc_set_foreground(gc, &color);
-	gdk_draw_arc(bitmap, gc, TRUE,
-		     d2i(cx - i2d(ri)), d2i(cy - i2d(ri)),
-		     d2i(2.0 * i2d(ri)), d2i(2.0 * i2d(ri)), 0, 360 * 64);
+		radar->play_source = g_timeout_add(1000 / radar->max_fps,
+						   radar_play_tick, radar);
+	}
+
+	radar_schedule_redraw(radar, FALSE);
+}
+
+static void
+play_value_changed(GtkRange *range, gpointer user_data)
+{
+	radar_t *radar = user_data;
+
+	radar->play_time = gtk_range_get_value(range);
+	radar_schedule_redraw(radar, FALSE);
+}
+
+static gchar *
+play_format_value(GtkScale *scale, gdouble value, gpointer user_data)
+{
+	radar_t *radar = user_data;
+	int t;
+
+	t = (int) floor(60.0 * (radar->play_base + value) + 0.5);
+	t %= 1440 * 60;
+
+	return g_strdup_printf("%02u:%02u:%02u",
+			       t / 3600, (t / 60) % 60, t % 60);
+}
+
+/*
+ * Fill the new backing pixmap with the old one, scaled by the ratio
+ * of the plot radii around the new center.
+ */
+static void
+radar_scale_pixmap(radar_t *radar, GdkPixmap *old, int old_w, int old_h,
+		   int old_r)
+{
+	GdkPixbuf *frame, *scaled;
+	double scale;
+	int w, h;
+
+	gdk_draw_rectangle(radar->pixmap, radar->white_gc, TRUE,
+			   0, 0, radar->w, radar->h);
+
+	if (old_r <= 0 || radar->r <= 0)
+		goto out;
+
+	frame = gdk_pixbuf_get_from_drawable(NULL, old,
+					     gdk_gc_get_colormap(radar->white_gc),
+					     0, 0, 0, 0, old_w, old_h);
+	if (NULL == frame)
+		goto out;
+
+	scale = ((double) radar->r) / ((double) old_r);
+	w = MAX(d2i(scale * old_w), 1);
+	h = MAX(d2i(scale * old_h), 1);
+
+	scaled = gdk_pixbuf_scale_simple(frame, w, h, GDK_INTERP_NEAREST);
+	g_object_unref(frame);
+	if (NULL == scaled)
+		goto out;
+
+	gdk_draw_pixbuf(radar->pixmap, radar->white_gc, scaled, 0, 0,
+			d2i(radar->cx - scale * old_w / 2.0),
+			d2i(radar->cy - scale * old_h / 2.0),
+			w, h, GDK_RGB_DITHER_NONE, 0, 0);
+	g_object_unref(scaled);
+
+out:
+	gtk_widget_queue_draw_area(radar->canvas, 0, 0, radar->w, radar->h);
+}
+
+/*
+ * The size has been stable for resize_delay ms: full quality redraw.
+ */
+static gboolean
+radar_resize_timeout(gpointer user_data)
+{
+	radar_t *radar = user_data;
 
-	g_object_unref(gc);
-	return bitmap;
+	radar->resize_source = 0;
+	radar->resize_draft = FALSE;
+	radar_schedule_redraw(radar, TRUE);
+	return FALSE;
 }
 
 /* Create a new backing pixmap of the appropriate size */
@@ -4435,32 +5868,15 @@ static int
 configure_event(GtkWidget *widget, GdkEventConfigure *event, gpointer user_data)
 {
 	radar_t *radar = user_data;
-	int tw, th, tick;
+	GdkPixmap *old = radar->pixmap;
+	int old_w = radar->w, old_h = radar->h, old_r = radar->r;
+	int tw, th;
 	char text[16];
 
 	if (!radar->white_gc)
 		radar_init_private_data(radar);
 
-	if (radar->pixmap) {
-		g_object_unref(radar->pixmap);
-		radar->pixmap = NULL;
-	}
-	if (radar->clip[0]) {
-		g_object_unref(radar->clip[0]);
-		radar->clip[0] = NULL;
-	}
-	if (radar->clip[1]) {
-		g_object_unref(radar->clip[1]);
-		radar->clip[1] = NULL;
-	}
-	if (radar->clip[2]) {
-		g_object_unref(radar->clip[2]);
-		radar->clip[2] = NULL;
-	}
-	if (radar->clip[3]) {
-		g_object_unref(radar->clip[3]);
-		radar->clip[3] = NULL;
-	}
+	radar->pixmap = NULL;
 
 	if (NULL == radar->busy_cursor)
 		radar->busy_cursor = gdk_cursor_new(GDK_WATCH);
@@ -4492,6 +5908,8 @@ configure_event(GtkWidget *widget, GdkEventConfigure *event, gpointer user_data)
 	radar->cx = ((double) radar->w) / 2;
 	radar->cy = ((double) radar->h) / 2;
 
+	radar_spatial_resize(radar);
+
 	snprintf(text, sizeof(text), "%03u", 270);
 	pango_layout_set_text(radar->layout, text, strlen(text));
 
@@ -4503,35 +5921,29 @@ configure_event(GtkWidget *widget, GdkEventConfigure *event, gpointer user_data)
 		radar->r = ((radar->h / 2 - tw) / 12) * 12;
 	radar->step = radar->r / 6;
 
-	tick = radar->step / 12;
-	if (tick < 4)
-		tick = 4;
-
-	if (!radar->do_render) {
-		radar->clip[0] = radar_create_clip_mask(radar->cx, radar->cy,
-							radar->w, radar->h,
-							radar->r - tick,
-							radar->r);
-		gdk_gc_set_clip_mask(radar->grey50_clip0_gc, radar->clip[0]);
+	/*
+	 * While the size keeps changing, show the old frame scaled and
+	 * redraw without antialiasing at the paced frame rate.
+	 */
+	if (old && radar->mapped && radar->resize_delay > 0) {
+		radar_scale_pixmap(radar, old, old_w, old_h, old_r);
+		g_object_unref(old);
 
-		radar->clip[1] = radar_create_clip_mask(radar->cx, radar->cy,
-							radar->w, radar->h, 
-							radar->r - 2 * tick,
-							radar->r);
-		gdk_gc_set_clip_mask(radar->grey50_clip1_gc, radar->clip[1]);
+		/* primitives are still in the old geometry */
+		g_array_set_size(radar->display_list, 0);
 
-		radar->clip[2] = radar_create_clip_mask(radar->cx, radar->cy,
-							radar->w, radar->h,
-							3 * radar->step / 4,
-							radar->r);
-		gdk_gc_set_clip_mask(radar->grey25_clip2_gc, radar->clip[2]);
+		radar->resize_draft = TRUE;
+		radar_schedule_redraw(radar, TRUE);
 
-		radar->clip[3] = radar_create_clip_mask(radar->cx, radar->cy,
-							radar->w, radar->h,
-							1 * radar->step / 4,
-							radar->r);
-		gdk_gc_set_clip_mask(radar->grey50_clip3_gc, radar->clip[3]);
+		if (radar->resize_source)
+			g_source_remove(radar->resize_source);
+		radar->resize_source = g_timeout_add(radar->resize_delay,
+						     radar_resize_timeout,
+						     radar);
+		return TRUE;
 	}
+	if (old)
+		g_object_unref(old);
 
 	gdk_window_set_cursor(radar->window->window, radar->busy_cursor);
 
@@ -4569,7 +5981,17 @@ expose_event(GtkWidget *widget, GdkEventExpose *event, gpointer user_data)
 	}
 	g_free(rects);
 
-	radar_draw_vectors(radar);
+	if (radar_use_render_thread(radar)) {
+		if (radar->frame &&
+		    gdk_pixbuf_get_width(radar->frame) == radar->w &&
+		    gdk_pixbuf_get_height(radar->frame) == radar->h)
+			gdk_draw_pixbuf(widget->window, radar->white_gc,
+					radar->frame, 0, 0, 0, 0,
+					radar->w, radar->h,
+					GDK_RGB_DITHER_NORMAL, 0, 0);
+	} else {
+		radar_draw_vectors(radar);
+	}
 
 	radar->wait_expose = FALSE;
 
@@ -4612,7 +6034,7 @@ orientation_changed(GtkComboBox *combo, gpointer user_data)
 #endif
 
 	if (radar->own_course != 0)
-		radar_draw_foreground(radar);
+		radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 }
@@ -4629,7 +6051,7 @@ heading_toggled(GtkToggleButton *toggle, gpointer user_data)
 	else
 		radar->show_heading = FALSE;
 
-	radar_draw_foreground(radar);
+	radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 
@@ -4649,12 +6071,7 @@ range_value_changed(GtkSpinButton *button, gpointer user_data)
 	radar->rindex = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(button));
 	radar->range = radar_ranges[radar->rindex].range;
 
-	gdk_window_set_cursor(radar->window->window, radar->busy_cursor);
-
-	radar_draw_background(radar);
-	radar_draw_foreground(radar);
-
-	gdk_window_set_cursor(radar->window->window, NULL);
+	radar_schedule_redraw(radar, TRUE);
 
 	radar->change_level--;
 
@@ -4700,7 +6117,7 @@ own_course_value_changed(GtkSpinButton *button, gpointer user_data)
 		}
 	}
 
-	radar_draw_foreground(radar);
+	radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 
@@ -4728,7 +6145,7 @@ own_speed_value_changed(GtkSpinButton *button, gpointer user_data)
 		nspeed = 0.0;
 	gtk_spin_button_set_value(radar->nspeed_spin, nspeed);
 
-	radar_draw_foreground(radar);
+	radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 
@@ -4747,7 +6164,7 @@ time0_value_changed(GtkSpinButton *button, gpointer user_data)
 
 	s->time[0] = gtk_spin_button_get_value_as_int(button);
 
-	radar_draw_foreground(radar);
+	radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 
@@ -4767,7 +6184,7 @@ time1_value_changed(GtkSpinButton *button, gpointer user_data)
 
 	s->time[1] = gtk_spin_button_get_value_as_int(button);
 
-	radar_draw_foreground(radar);
+	radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 
@@ -4799,7 +6216,7 @@ rasp0_toggled(GtkToggleButton *toggle, gpointer user_data)
 		gtk_widget_set_sensitive(GTK_WIDGET(s->rakrp_spin[0]), TRUE);
 	}
 
-	radar_draw_foreground(radar);
+	radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 
@@ -4831,7 +6248,7 @@ rasp0_course_changed(GtkSpinButton *button, gpointer user_data)
 		gtk_spin_button_set_value(s->rasp_spin[0], s->rasp[0]);
 	}
 
-	radar_draw_foreground(radar);
+	radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 
@@ -4853,7 +6270,7 @@ rasp0_value_changed(GtkSpinButton *button, gpointer user_data)
 	s->rakrp[0] = (360 + s->rasp[0] + radar->own_course - s->rasp_course_offset[0]) % 360;
 	gtk_spin_button_set_value(s->rakrp_spin[0], s->rakrp[0]);
 
-	radar_draw_foreground(radar);
+	radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 
@@ -4875,7 +6292,7 @@ rakrp0_value_changed(GtkSpinButton *button, gpointer user_data)
 	s->rasp[0] = (720 + s->rakrp[0] - (radar->own_course - s->rasp_course_offset[0])) % 360;
 	gtk_spin_button_set_value(s->rasp_spin[0], s->rasp[0]);
 
-	radar_draw_foreground(radar);
+	radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 
@@ -4907,7 +6324,7 @@ rasp1_toggled(GtkToggleButton *toggle, gpointer user_data)
 		gtk_widget_set_sensitive(GTK_WIDGET(s->rakrp_spin[1]), TRUE);
 	}
 
-	radar_draw_foreground(radar);
+	radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 
@@ -4939,7 +6356,7 @@ rasp1_course_changed(GtkSpinButton *button, gpointer user_data)
 		gtk_spin_button_set_value(s->rasp_spin[1], s->rasp[1]);
 	}
 
-	radar_draw_foreground(radar);
+	radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 
@@ -4961,7 +6378,7 @@ rasp1_value_changed(GtkSpinButton *button, gpointer user_data)
 	s->rakrp[1] = (360 + s->rasp[1] + radar->own_course - s->rasp_course_offset[1]) % 360;
 	gtk_spin_button_set_value(s->rakrp_spin[1], s->rakrp[1]);
 
-	radar_draw_foreground(radar);
+	radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 
@@ -4983,7 +6400,7 @@ rakrp1_value_changed(GtkSpinButton *button, gpointer user_data)
 	s->rasp[1] = (720 + s->rakrp[1] - (radar->own_course - s->rasp_course_offset[1])) % 360;
 	gtk_spin_button_set_value(s->rasp_spin[1], s->rasp[1]);
 
-	radar_draw_foreground(radar);
+	radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 
@@ -5005,7 +6422,7 @@ dist0_value_changed(GtkSpinButton *button, gpointer user_data)
 	if (s->distance[0] < EPSILON)
 		s->distance[0] = 0.0;
 
-	radar_draw_foreground(radar);
+	radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 
@@ -5030,7 +6447,7 @@ dist1_value_changed(GtkSpinButton *button, gpointer user_data)
 	printf("%s: Distance 1: %.1f\n", __FUNCTION__, s->distance[1]);
 #endif
 
-	radar_draw_foreground(radar);
+	radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 }
@@ -5052,7 +6469,7 @@ mtime_toggled(GtkToggleButton *toggle, gpointer user_data)
 		gtk_widget_set_sensitive(GTK_WIDGET(radar->mdist_spin), TRUE);
 	}
 
-	radar_draw_foreground(radar);
+	radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 
@@ -5078,7 +6495,7 @@ mtime_value_changed(GtkSpinButton *button, gpointer user_data)
 #endif
 
 	if (radar->mtime_selected)
-		radar_draw_foreground(radar);
+		radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 }
@@ -5098,7 +6515,7 @@ mdist_value_changed(GtkSpinButton *button, gpointer user_data)
 #endif
 
 	if (!radar->mtime_selected)
-		radar_draw_foreground(radar);
+		radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 }
@@ -5152,7 +6569,7 @@ target_changed(GtkComboBox *combo, gpointer user_data)
 		}
 	}
 
-	radar_draw_foreground(radar);
+	radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 
@@ -5196,7 +6613,7 @@ maneuver_changed(GtkComboBox *combo, gpointer user_data)
 		gtk_widget_hide(GTK_WIDGET(radar->ncourse_spin));
 	}
 
-	radar_draw_foreground(radar);
+	radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 
@@ -5225,7 +6642,7 @@ mcpa_toggled(GtkToggleButton *toggle, gpointer user_data)
 		gtk_widget_set_sensitive(GTK_WIDGET(radar->ncourse_spin), TRUE);
 	}
 
-	radar_draw_foreground(radar);
+	radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 }
@@ -5240,7 +6657,7 @@ mcpa_value_changed(GtkSpinButton *button, gpointer user_data)
 	radar->mcpa = gtk_spin_button_get_value(button);
 
 	if (radar->mcpa_selected)
-		radar_draw_foreground(radar);
+		radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 
@@ -5259,7 +6676,7 @@ ncourse_value_changed(GtkSpinButton *button, gpointer user_data)
 	radar->ncourse = gtk_spin_button_get_value(button);
 
 	if (!radar->mcpa_selected)
-		radar_draw_foreground(radar);
+		radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 
@@ -5278,7 +6695,7 @@ nspeed_value_changed(GtkSpinButton *button, gpointer user_data)
 	radar->nspeed = gtk_spin_button_get_value(button);
 
 	if (!radar->mcpa_selected)
-		radar_draw_foreground(radar);
+		radar_schedule_redraw(radar, FALSE);
 
 	radar->change_level--;
 
@@ -6635,6 +8052,41 @@ radar_create_window(radar_t *radar)
 	radar->nspeed_spin = GTK_SPIN_BUTTON(button);
 	radar->nspeed = 0.0;
 
+
+/*
+ * Playback:
+ */
+	frame = gtk_frame_new(_("Playback"));
+	gtk_box_pack_start(GTK_BOX(maneuver_vbox), frame, FALSE, FALSE, 0);
+	gtk_widget_show(frame);
+
+	hbox = gtk_hbox_new(FALSE, TABLE_COL_SPACING);
+	gtk_container_set_border_width(GTK_CONTAINER(hbox), 5);
+	gtk_container_add(GTK_CONTAINER(frame), hbox);
+	gtk_widget_show(hbox);
+
+	button = gtk_toggle_button_new_with_label(_("Play"));
+	gtk_box_pack_start(GTK_BOX(hbox), button, FALSE, FALSE, 0);
+	gtk_widget_show(button);
+	radar_set_tooltip(radar, button,
+			  _("Move Targets along their Tracks"), 0);
+	g_signal_connect(G_OBJECT(button), "toggled",
+			 G_CALLBACK(play_toggled), radar);
+	radar->play_toggle = GTK_TOGGLE_BUTTON(button);
+
+	button = gtk_hscale_new_with_range(0.0, RADAR_PLAY_MINUTES, 0.1);
+	gtk_scale_set_value_pos(GTK_SCALE(button), GTK_POS_LEFT);
+	gtk_box_pack_start(GTK_BOX(hbox), button, TRUE, TRUE, 0);
+	gtk_widget_show(button);
+	radar_set_tooltip(radar, button, _("Simulated Time"), 0);
+	g_signal_connect(G_OBJECT(button), "value-changed",
+			 G_CALLBACK(play_value_changed), radar);
+	g_signal_connect(G_OBJECT(button), "format-value",
+			 G_CALLBACK(play_format_value), radar);
+	radar->play_scale = GTK_RANGE(button);
+	radar->play_timer = g_timer_new();
+	radar->play_time = 0.0;
+
 	gtk_container_set_focus_chain(GTK_CONTAINER(panel_table), focus);
 
 	screen = gtk_widget_get_screen(radar->window);
@@ -6658,16 +8110,6 @@ radar_create_window(radar_t *radar)
 	return 0;
 }
 
-static GdkGC *
-radar_init_gc_copy(radar_t *radar, GdkGC *src)
-{
-	GdkGC *gc;
-
-	gc = gdk_gc_new(radar->canvas->window);
-	gdk_gc_copy(gc, src);
-	return gc;
-}
-
 static GdkGC *
 radar_init_gc_data(radar_t *radar, int red, int green, int blue,
 		   int line_width, int line_cap)
@@ -6716,11 +8158,6 @@ radar_init_private_data(radar_t *radar)
 				   GDK_CAP_ROUND, GDK_JOIN_ROUND);
 	gdk_gc_set_dashes(radar->green_dash_gc, 0, dashes, 2);
 
-	radar->grey25_clip2_gc = radar_init_gc_copy(radar, radar->grey25_gc);
-	radar->grey50_clip0_gc = radar_init_gc_copy(radar, radar->grey50_gc);
-	radar->grey50_clip1_gc = radar_init_gc_copy(radar, radar->grey50_gc);
-	radar->grey50_clip3_gc = radar_init_gc_copy(radar, radar->grey50_gc);
-
 	context = gtk_widget_get_pango_context(radar->canvas);
 	radar->layout = pango_layout_new(context);
 	font_description = pango_font_description_from_string(LABEL_FONT);
@@ -6735,6 +8172,22 @@ radar_init_private_data(radar_t *radar)
 
 	pango_layout_set_attributes(radar->layout, attrs);
 
+	radar->label_cache = g_hash_table_new_full(g_str_hash, g_str_equal,
+						   NULL,
+						   radar_free_label_bitmap);
+	radar->label_lru = g_queue_new();
+
+	radar->display_list = g_array_new(FALSE, FALSE,
+					  sizeof(display_item_t));
+	radar->display_styles = g_array_new(FALSE, FALSE,
+					    sizeof(display_style_t));
+
+	if (radar->render_thread && g_thread_supported()) {
+		radar->frame_damage = gdk_region_new();
+		radar->render_worker = raster_worker_new(radar_frame_ready,
+							 radar);
+	}
+
 	for (i = 0; i < RADAR_NR_TARGETS; i++) {
 		s = &radar->target[i];
 
@@ -6852,11 +8305,16 @@ radar_load_config(radar_t *radar, const char *filename)
 {
 	gchar *path;
 	gboolean bvalue;
+	gint ivalue;
 	GError *error;
 
 	radar->do_render = TRUE;
 	radar->default_heading = TRUE;
 	radar->default_rakrp = FALSE;
+	radar->max_fps = RADAR_MAX_FPS;
+	radar->export_threads = 0;
+	radar->resize_delay = RADAR_RESIZE_DELAY;
+	radar->render_thread = TRUE;
 
 	path = g_build_filename(g_get_home_dir(), filename, NULL);
 	if (NULL == path)
@@ -6895,6 +8353,34 @@ radar_load_config(radar_t *radar, const char *filename)
 		radar->default_rakrp = bvalue;
 
 	error = NULL;
+	ivalue = g_key_file_get_integer(radar->key_file,
+					"Radarplot", "MaxFPS",
+					&error);
+	if (NULL == error && ivalue > 0)
+		radar->max_fps = ivalue;
+
+	error = NULL;
+	ivalue = g_key_file_get_integer(radar->key_file,
+					"Radarplot", "ExportThreads",
+					&error);
+	if (NULL == error && ivalue >= 0)
+		radar->export_threads = ivalue;
+
+	error = NULL;
+	ivalue = g_key_file_get_integer(radar->key_file,
+					"Radarplot", "ResizeDelay",
+					&error);
+	if (NULL == error && ivalue >= 0)
+		radar->resize_delay = ivalue;
+
+	error = NULL;
+	bvalue = g_key_file_get_boolean(radar->key_file,
+					"Radarplot", "RenderThread",
+					&error);
+	if (NULL == error)
+		radar->render_thread = bvalue;
+
+	error = NULL;
 
 out:
 	g_free(path);
@@ -6938,6 +8424,9 @@ main(int argc, char **argv)
 	progname = g_path_get_basename(argv[0]);
 	progpath = g_path_get_dirname(argv[0]);
 
+	if (!g_thread_supported())
+		g_thread_init(NULL);
+
 	gtk_init(&argc, &argv);
 
 	radar_setup_locale();
@@ -20,6 +20,12 @@
 #define LABEL_BASE		"Sans"
 #define LABEL_FONT		LABEL_BASE " 10"
 
+#define LABEL_CACHE_SIZE	256
+
+#define SPATIAL_CELL_SIZE	32
+
+#define ARC_CACHE_SIZE		32
+
 
 #define ALIGN_LEFT		0.0
 #define ALIGN_RIGHT		1.0
@@ -45,12 +51,33 @@
 #define PORT			(-1.0)
 
 
+typedef struct {
+	int		is_hashed;
+	int		is_arc;
+	gpointer	prim;		/* vector_t or arc_t */
+	int		x1, y1;		/* first and last grid cell covered */
+	int		x2, y2;
+	unsigned int	stamp;		/* last spatial query seen in */
+} hash_node_t;
+
+/*
+ * State of a primitive in the previous frame, to repaint only what
+ * changed.
+ */
+typedef struct {
+	int		was_visible;
+	guint32		hash;		/* geometry and style, 0: invisible */
+	GdkRectangle	bbox;
+} scene_slot_t;
+
 typedef struct {
 	int		is_visible;
 	double		x1, y1;
 	double		x2, y2;
 	GdkGC		*gc;
 	GdkRectangle	bbox;
+	hash_node_t	node;
+	scene_slot_t	slot;
 } vector_t;
 
 typedef struct {
@@ -60,6 +87,8 @@ typedef struct {
 	double		angle1, angle2;
 	GdkGC		*gc;
 	GdkRectangle	bbox;
+	hash_node_t	node;
+	scene_slot_t	slot;
 } arc_t;
 
 typedef struct {
@@ -73,8 +102,61 @@ typedef struct {
 	char		*markup;
 	PangoLayout	*layout;
 	GdkRectangle	bbox;
+	scene_slot_t	slot;
 } text_label_t;
 
+typedef enum {
+	LABEL_HALO_CROSS = 0,	/* antialiased, halo offset by one pixel */
+	LABEL_HALO_BOX		/* opaque, halo 3x3 around each pixel */
+} label_halo_t;
+
+typedef struct {
+	char		*key;
+	GdkPixbuf	*pixbuf;	/* RGBA, 2 pixel margin around text */
+	int		tw, th;
+	GList		*link;		/* position in LRU queue */
+} label_bitmap_t;
+
+enum display_item_type {
+	DISPLAY_VECTOR = 0,
+	DISPLAY_ARC,
+	DISPLAY_POLY,
+	DISPLAY_LABEL
+};
+
+typedef struct {
+	GdkGC		*gc;
+	guint32		rgb;		/* 0xRRGGBB */
+	int		line_width;
+	int		line_style;
+} display_style_t;
+
+typedef struct {
+	int		type;
+	int		style;		/* index into display_styles */
+	int		is_target;	/* not an own ship primitive */
+	gpointer	prim;		/* vector_t, arc_t, poly_t, text_label_t */
+} display_item_t;
+
+/*
+ * Maps plot coordinates of the screen onto an output of plot radius r
+ * around (cx, cy).  Labels are laid out again on context in font.
+ */
+typedef struct {
+	double		cx, cy;
+	int		r;
+	PangoContext	*context;
+	PangoFontDescription *font;
+} display_xform_t;
+
+typedef struct {
+	double		x, y;
+	double		radius;
+	double		angle1, angle2;
+	double		halfwidth;
+	GList		*traps;		/* NULL: entry unused */
+} arc_tess_t;
+
 
 typedef struct {
 	double		x;
@@ -106,6 +188,7 @@ typedef struct {
 	int		npoints;
 	GdkGC		*gc;
 	GdkRectangle	bbox;
+	scene_slot_t	slot;
 } poly_t;
 
 enum radar_vector_number {
@@ -130,6 +213,9 @@ enum target_vector_number {
 	VECTOR_POSY1,
 	VECTOR_MPOINTX,
 	VECTOR_MPOINTY,
+	VECTOR_PLAYX,
+	VECTOR_PLAYY,
+	VECTOR_PLAY_RANGE,
 	TARGET_NR_VECTORS
 };
 
@@ -151,6 +237,7 @@ enum target_poly_number {
 enum target_label_number {
 	LABEL_SIGHT0 = 0,
 	LABEL_SIGHT1,
+	LABEL_PLAY,
 	TARGET_NR_LABELS
 };
 
@@ -181,6 +268,9 @@ extern range_t radar_ranges[];
 struct __radar_s__;
 typedef struct __radar_s__ radar_t;
 
+struct __raster_s__;
+struct __raster_worker_s__;
+
 
 typedef struct {
 	int		index;
@@ -249,6 +339,8 @@ typedef struct {
 	vector_xy_t	new_cpa;
 	vector_xy_t	xpoint;
 	vector_xy_t	new_cross;
+	vector_xy_t	play;		/* position at play time */
+	gboolean	have_play;
 
 	GtkSpinButton	*time_spin[2];
 	GtkToggleButton	*rasp_radio[2];
@@ -345,16 +437,44 @@ struct __radar_s__ {
 	int		mapped;
 	int		change_level;
 
+	int		max_fps;
+	guint		redraw_source;
+	gboolean	redraw_background;
+	GTimeVal	redraw_time;
+	unsigned long	redraw_requests;
+	unsigned long	redraw_coalesced;
+
+	int		resize_delay;	/* ms, 0: full redraw on each resize */
+	guint		resize_source;
+	gboolean	resize_draft;
+
+	gboolean	render_thread;
+	struct __raster_worker_s__ *render_worker;
+	GdkPixbuf	*frame;		/* last frame from render_worker */
+	unsigned long	frame_seq;	/* last frame submitted */
+	GdkRegion	*frame_damage;	/* to repaint once frame_seq is in */
+
+	gboolean	playing;
+	double		play_base;	/* clock minutes at play_time 0 */
+	double		play_time;	/* minutes after play_base */
+	guint		play_source;
+	GTimer		*play_timer;
+	double		play_last;	/* play_timer at last tick */
+	unsigned long	play_frames;
+	double		play_draw_time;	/* seconds spent in those frames */
+	double		play_stat;	/* play_timer at last report */
+
 	vector_t	vectors[RADAR_NR_VECTORS];
 
+	GSList		**spatial_cells;
+	int		spatial_cols;
+	int		spatial_rows;
+	unsigned int	spatial_stamp;
+
 	GdkGC		*white_gc;
 	GdkGC		*black_gc;
 	GdkGC		*grey25_gc;
-	GdkGC		*grey25_clip2_gc;
 	GdkGC		*grey50_gc;
-	GdkGC		*grey50_clip0_gc;
-	GdkGC		*grey50_clip1_gc;
-	GdkGC		*grey50_clip3_gc;
 	GdkGC		*green_gc;
 	GdkGC		*green_dash_gc;
 
@@ -383,14 +503,18 @@ struct __radar_s__ {
 	GtkToggleButton	*nspeed_radio;
 	GtkSpinButton	*nspeed_spin;
 
+	GtkToggleButton	*play_toggle;
+	GtkRange	*play_scale;
+
 	gboolean	do_render;
 	gboolean	default_heading;
 	gboolean	default_rakrp;
 
+	int		export_threads;
+	struct __raster_s__ *raster;	/* record drawing for export */
+
 	PangoLayout	*layout;
 	GdkPixmap	*pixmap;
-	GdkBitmap	*clip[4];
-
 	GdkPixbuf	*icon16;
 	GdkPixbuf	*icon32;
 	GdkPixbuf	*icon48;
@@ -399,6 +523,15 @@ struct __radar_s__ {
 	GdkPixbuf	*backbuf;
 	GdkPixbuf	*forebuf;
 
+	GHashTable	*label_cache;
+	GQueue		*label_lru;
+
+	arc_tess_t	arc_cache[ARC_CACHE_SIZE];
+	int		arc_cache_next;
+
+	GArray		*display_list;	/* display_item_t */
+	GArray		*display_styles; /* display_style_t */
+
 	GdkCursor	*busy_cursor;
 
 	char		*plot_pathname;
@@ -447,14 +580,26 @@ radar_draw_bg_pixmap(radar_t *radar, GdkDrawable *drawable,
                      double cx, double cy, int step, int radius,
                      int width, int height);
 
+void
+radar_draw_display_list(radar_t *radar, GdkDrawable *drawable,
+			GdkPixbuf *pixbuf, guchar alpha, gboolean render,
+			const display_xform_t *xf);
+
+void	radar_flush_redraw(radar_t *radar);
+
 GtkWidget *radar_init_spin(double min, double max, double step, double page,
 			   double init);
 
 void	radar_save_config(radar_t *radar, const char *filename);
 
+int	radar_load(radar_t *radar, const char *filename);
+int	radar_save(radar_t *radar, const char *filename);
+
 void	radar_export_jpeg(GtkAction *action, gpointer user_data);
 void	radar_export_png(GtkAction *action, gpointer user_data);
 void	radar_export_pdf(GtkAction *action, gpointer user_data);
+void	radar_export_report(GtkAction *action, gpointer user_data);
+void	radar_export_plots(GtkAction *action, gpointer user_data);
 
 void	radar_register(GtkAction *action, gpointer user_data);
 void	radar_license(GtkAction *action, gpointer user_data);
@@ -0,0 +1,935 @@
+/* $Id$
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <setjmp.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <png.h>
+
+#include <gtk/gtk.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <pango/pangocairo.h>
+
+#include "radar.h"
+#include "raster.h"
+
+
+typedef struct {
+	int		x, y;
+	int		width, height;
+	GPtrArray	*ops;
+} raster_tile_t;
+
+typedef struct {
+	raster_t	*raster;
+	guchar		*data;		/* RGBA rows y0 ... */
+	guint		stride;
+	int		y0;
+} raster_job_t;
+
+
+raster_t *
+raster_new(int width, int height)
+{
+	raster_t *raster;
+
+	raster = g_new0(raster_t, 1);
+	raster->width = width;
+	raster->height = height;
+	raster->background = 0xffffff;
+	raster->background_alpha = 0;
+	raster->ops = g_ptr_array_new();
+
+	return raster;
+}
+
+void
+raster_free(raster_t *raster)
+{
+	raster_op_t *op;
+	int i;
+
+	for (i = 0; i < raster->ops->len; i++) {
+		op = g_ptr_array_index(raster->ops, i);
+
+		g_free(op->traps);
+		g_free(op->image);
+		g_free(op);
+	}
+
+	g_ptr_array_free(raster->ops, TRUE);
+	g_free(raster);
+}
+
+/*
+ * Pango context for export layouts, on a cairo font map of its own
+ * so that no X display is involved in measuring or drawing text.
+ */
+PangoContext *
+raster_create_pango_context(void)
+{
+	static PangoFontMap *fontmap = NULL;
+
+	if (NULL == fontmap)
+		fontmap = pango_cairo_font_map_new();
+
+	return pango_cairo_font_map_create_context(
+			PANGO_CAIRO_FONT_MAP(fontmap));
+}
+
+void
+raster_fill(raster_t *raster, guint32 rgb, guchar alpha)
+{
+	raster->background = rgb;
+	raster->background_alpha = alpha;
+}
+
+static void
+raster_clip_op(raster_t *raster, raster_op_t *op)
+{
+	op->x1 = MAX(op->x1, 0);
+	op->y1 = MAX(op->y1, 0);
+	op->x2 = MIN(op->x2, raster->width);
+	op->y2 = MIN(op->y2, raster->height);
+}
+
+/*
+ * Takes over traps, an array of n.
+ */
+static int
+raster_add_op_traps(raster_t *raster, guint32 rgb, guchar alpha,
+		    trapezoid_t *traps, int n)
+{
+	double x1, y1, x2, y2;
+	trapezoid_t *trap;
+	raster_op_t *op;
+	int i;
+
+	op = g_new0(raster_op_t, 1);
+	op->type = RASTER_OP_TRAPS;
+	op->rgb = rgb;
+	op->alpha = alpha;
+	op->traps = traps;
+	op->ntraps = n;
+
+	x1 = y1 = G_MAXDOUBLE;
+	x2 = y2 = -G_MAXDOUBLE;
+
+	for (i = 0; i < n; i++) {
+		trap = &traps[i];
+
+		x1 = MIN(x1, MIN(trap->x11, trap->x12));
+		x2 = MAX(x2, MAX(trap->x21, trap->x22));
+		y1 = MIN(y1, trap->y1);
+		y2 = MAX(y2, trap->y2);
+	}
+
+	op->x1 = (int) floor(x1) - 1;
+	op->y1 = (int) floor(y1) - 1;
+	op->x2 = (int) ceil(x2) + 1;
+	op->y2 = (int) ceil(y2) + 1;
+	raster_clip_op(raster, op);
+
+	g_ptr_array_add(raster->ops, op);
+	return 0;
+}
+
+int
+raster_add_traps(raster_t *raster, guint32 rgb, guchar alpha, GList *traps)
+{
+	trapezoid_t *array;
+	GList *p;
+	int n;
+
+	n = g_list_length(traps);
+	if (0 == n)
+		return 0;
+
+	array = g_new(trapezoid_t, n);
+	for (p = traps, n = 0; p; p = p->next, n++)
+		array[n] = *(trapezoid_t *) p->data;
+
+	return raster_add_op_traps(raster, rgb, alpha, array, n);
+}
+
+int
+raster_add_trap_array(raster_t *raster, guint32 rgb, guchar alpha,
+		      const trapezoid_t *traps, int n)
+{
+	if (0 == n)
+		return 0;
+
+	return raster_add_op_traps(raster, rgb, alpha,
+				   g_memdup(traps, n * sizeof(trapezoid_t)), n);
+}
+
+int
+raster_add_image(raster_t *raster, GdkPixbuf *pixbuf, int x, int y,
+		 guchar alpha)
+{
+	raster_op_t *op;
+	guchar *data, *p;
+	guint32 *q;
+	guint a, stride;
+	int row, col;
+
+	if (gdk_pixbuf_get_n_channels(pixbuf) != 4) {
+		fprintf(stderr, "%s: pixbuf without alpha channel\n",
+			__FUNCTION__);
+		return -EINVAL;
+	}
+
+	op = g_new0(raster_op_t, 1);
+	op->type = RASTER_OP_IMAGE;
+	op->alpha = alpha;
+	op->x = x;
+	op->y = y;
+	op->width = gdk_pixbuf_get_width(pixbuf);
+	op->height = gdk_pixbuf_get_height(pixbuf);
+	op->image = g_new(guint32, op->width * op->height);
+
+	data = gdk_pixbuf_get_pixels(pixbuf);
+	stride = gdk_pixbuf_get_rowstride(pixbuf);
+
+	q = op->image;
+	for (row = 0; row < op->height; row++) {
+		p = data + row * stride;
+
+		for (col = 0; col < op->width; col++, p += 4) {
+			a = p[3];
+			*q++ = (a << 24) |
+			       (((p[0] * a + 127) / 255) << 16) |
+			       (((p[1] * a + 127) / 255) << 8) |
+			       ((p[2] * a + 127) / 255);
+		}
+	}
+
+	op->x1 = x;
+	op->y1 = y;
+	op->x2 = x + op->width;
+	op->y2 = y + op->height;
+	raster_clip_op(raster, op);
+
+	g_ptr_array_add(raster->ops, op);
+	return 0;
+}
+
+/*
+ * Signed area accumulation buffer of one tile, width + 2 floats per
+ * row.  A running sum along a row gives the coverage of each pixel.
+ */
+typedef struct {
+	float		*acc;
+	int		width, height;
+	int		stride;
+} raster_cover_t;
+
+static inline guint
+raster_mul255(guint a, guint b)
+{
+	guint t = a * b + 128;
+
+	return (t + (t >> 8)) >> 8;
+}
+
+/*
+ * Premultiplied src OVER dst.
+ */
+static inline guint32
+raster_over(guint32 src, guint32 dst)
+{
+	guint ia = 255 - (src >> 24);
+
+	return src + ((raster_mul255(dst >> 24, ia) << 24) |
+		      (raster_mul255((dst >> 16) & 0xff, ia) << 16) |
+		      (raster_mul255((dst >> 8) & 0xff, ia) << 8) |
+		      raster_mul255(dst & 0xff, ia));
+}
+
+static inline guint32
+raster_scale(guint32 src, guint a)
+{
+	return (raster_mul255(src >> 24, a) << 24) |
+	       (raster_mul255((src >> 16) & 0xff, a) << 16) |
+	       (raster_mul255((src >> 8) & 0xff, a) << 8) |
+	       raster_mul255(src & 0xff, a);
+}
+
+/*
+ * Fill n pixels with the premultiplied color src.  The SSE2 loop
+ * rounds exactly like raster_over(), so output does not depend on the
+ * instruction set.
+ */
+static void
+raster_span_fill(guint32 *dst, int n, guint32 src)
+{
+	guint ia = 255 - (src >> 24);
+#ifdef __SSE2__
+	__m128i s, a, r, z, d, lo, hi;
+
+	s = _mm_set1_epi32(src);
+
+	if (0 == ia) {
+		for (; n >= 4; n -= 4, dst += 4)
+			_mm_storeu_si128((__m128i *) dst, s);
+	} else {
+		a = _mm_set1_epi16(ia);
+		r = _mm_set1_epi16(128);
+		z = _mm_setzero_si128();
+
+		for (; n >= 4; n -= 4, dst += 4) {
+			d = _mm_loadu_si128((__m128i *) dst);
+
+			lo = _mm_unpacklo_epi8(d, z);
+			lo = _mm_add_epi16(_mm_mullo_epi16(lo, a), r);
+			lo = _mm_srli_epi16(_mm_add_epi16(lo,
+						_mm_srli_epi16(lo, 8)), 8);
+
+			hi = _mm_unpackhi_epi8(d, z);
+			hi = _mm_add_epi16(_mm_mullo_epi16(hi, a), r);
+			hi = _mm_srli_epi16(_mm_add_epi16(hi,
+						_mm_srli_epi16(hi, 8)), 8);
+
+			d = _mm_packus_epi16(lo, hi);
+			_mm_storeu_si128((__m128i *) dst, _mm_add_epi8(d, s));
+		}
+	}
+#endif
+
+	if (0 == ia) {
+		while (n--)
+			*dst++ = src;
+		return;
+	}
+
+	while (n--) {
+		*dst = raster_over(src, *dst);
+		dst++;
+	}
+}
+
+/*
+ * Accumulate the edge (x0, y0) - (x1, y1), y0 < y1, lying within the
+ * tile, with winding dir.  Each row receives the exact area left of
+ * the edge inside every pixel it crosses.
+ */
+static void
+raster_line(raster_cover_t *c, double dir,
+	    double x0, double y0, double x1, double y1)
+{
+	double dxdy, dy, d, x, xnext, xa, xb, xaf, xbf, s, a0, a1, a2, am;
+	float *acc;
+	int xai, xbi, i, y;
+
+	dxdy = (x1 - x0) / (y1 - y0);
+	x = x0;
+
+	for (y = (int) y0; y < MIN(c->height, (int) ceil(y1)); y++) {
+		acc = c->acc + y * c->stride;
+
+		dy = MIN(y + 1.0, y1) - MAX((double) y, y0);
+		xnext = x + dxdy * dy;
+		d = dy * dir;
+
+		xa = MIN(x, xnext);
+		xb = MAX(x, xnext);
+		xaf = floor(xa);
+		xai = (int) xaf;
+		xbi = (int) ceil(xb);
+
+		if (xbi <= xai + 1) {
+			am = 0.5 * (x + xnext) - xaf;
+			acc[xai] += d - d * am;
+			acc[xai + 1] += d * am;
+		} else {
+			s = 1.0 / (xb - xa);
+			xaf = xa - xaf;
+			a0 = 0.5 * s * (1.0 - xaf) * (1.0 - xaf);
+			xbf = xb - xbi + 1.0;
+			am = 0.5 * s * xbf * xbf;
+
+			acc[xai] += d * a0;
+			if (xbi == xai + 2) {
+				acc[xai + 1] += d * (1.0 - a0 - am);
+			} else {
+				a1 = s * (1.5 - xaf);
+				acc[xai + 1] += d * (a1 - a0);
+				for (i = xai + 2; i < xbi - 1; i++)
+					acc[i] += d * s;
+				a2 = a1 + (xbi - xai - 3) * s;
+				acc[xbi - 1] += d * (1.0 - a2 - am);
+			}
+			acc[xbi] += d * am;
+		}
+
+		x = xnext;
+	}
+}
+
+/*
+ * Clip an edge in tile coordinates to the tile rows, and cut it where
+ * it leaves the tile columns.  Parts left of the tile are moved onto
+ * column 0, where they still count for every pixel to the right;
+ * parts right of the tile end up beyond the last column.
+ */
+static void
+raster_edge(raster_cover_t *c, double x0, double y0, double x1, double y1)
+{
+	double dir = 1.0, dxdy, t;
+	double ys[4], xs[4];
+	int n, i;
+
+	if (y0 == y1)
+		return;
+
+	if (y0 > y1) {
+		t = x0; x0 = x1; x1 = t;
+		t = y0; y0 = y1; y1 = t;
+		dir = -1.0;
+	}
+
+	if (y1 <= 0.0 || y0 >= c->height)
+		return;
+
+	dxdy = (x1 - x0) / (y1 - y0);
+	if (y0 < 0.0) {
+		x0 -= y0 * dxdy;
+		y0 = 0.0;
+	}
+	if (y1 > c->height) {
+		x1 -= (y1 - c->height) * dxdy;
+		y1 = c->height;
+	}
+
+	n = 0;
+	ys[n++] = y0;
+	if (MIN(x0, x1) < 0.0 && MAX(x0, x1) > 0.0)
+		ys[n++] = y0 - x0 / dxdy;
+	if (MIN(x0, x1) < c->width && MAX(x0, x1) > c->width)
+		ys[n++] = y0 + (c->width - x0) / dxdy;
+	if (n == 3 && ys[1] > ys[2]) {
+		t = ys[1]; ys[1] = ys[2]; ys[2] = t;
+	}
+	ys[n++] = y1;
+
+	for (i = 0; i < n; i++) {
+		if (i == 0)
+			xs[i] = x0;
+		else if (i == n - 1)
+			xs[i] = x1;
+		else
+			xs[i] = x0 + (ys[i] - y0) * dxdy;
+		xs[i] = CLAMP(xs[i], 0.0, (double) c->width);
+	}
+
+	for (i = 0; i < n - 1; i++) {
+		if (ys[i + 1] > ys[i])
+			raster_line(c, dir, xs[i], ys[i], xs[i + 1], ys[i + 1]);
+	}
+}
+
+/*
+ * Fill the trapezoids of op into the tile pixels with analytic
+ * coverage.  Trapezoids of one op are merged by adding up their
+ * coverage, so shared edges show no seams.
+ */
+static void
+raster_fill_traps(raster_tile_t *tile, raster_cover_t *c, guint32 *pixels,
+		  raster_op_t *op)
+{
+	trapezoid_t *trap;
+	guint32 src, *p;
+	double ox, oy;
+	float sum;
+	int y1, x2, y2;
+	int row, col, run, cv;
+	int i;
+
+	ox = tile->x;
+	oy = tile->y;
+
+	for (i = 0; i < op->ntraps; i++) {
+		trap = &op->traps[i];
+
+		raster_edge(c, trap->x21 - ox, trap->y1 - oy,
+			    trap->x22 - ox, trap->y2 - oy);
+		raster_edge(c, trap->x12 - ox, trap->y2 - oy,
+			    trap->x11 - ox, trap->y1 - oy);
+	}
+
+	src = (op->alpha << 24) |
+	      (raster_mul255((op->rgb >> 16) & 0xff, op->alpha) << 16) |
+	      (raster_mul255((op->rgb >> 8) & 0xff, op->alpha) << 8) |
+	      raster_mul255(op->rgb & 0xff, op->alpha);
+
+	y1 = MAX(op->y1 - tile->y, 0);
+	x2 = MIN(op->x2 - tile->x, tile->width);
+	y2 = MIN(op->y2 - tile->y, tile->height);
+
+	for (row = y1; row < y2; row++) {
+		p = pixels + row * tile->width;
+
+		sum = 0.0;
+		run = 0;
+		/* from 0, so coverage clipped at the left is summed */
+		for (col = 0; col < x2; col++) {
+			sum += c->acc[row * c->stride + col];
+			c->acc[row * c->stride + col] = 0.0;
+
+			cv = (int) (MIN(fabsf(sum), 1.0) * 255.0 + 0.5);
+			if (cv == 255) {
+				run++;
+				continue;
+			}
+
+			if (run) {
+				raster_span_fill(&p[col - run], run, src);
+				run = 0;
+			}
+			if (cv)
+				p[col] = raster_over(raster_scale(src, cv),
+						     p[col]);
+		}
+		if (run)
+			raster_span_fill(&p[col - run], run, src);
+
+		for (; col < c->stride; col++)
+			c->acc[row * c->stride + col] = 0.0;
+	}
+}
+
+static void
+raster_draw_image(raster_tile_t *tile, guint32 *pixels, raster_op_t *op)
+{
+	guint32 *p, *s;
+	int x1, y1, x2, y2;
+	int row, col;
+
+	x1 = MAX(op->x1, tile->x);
+	y1 = MAX(op->y1, tile->y);
+	x2 = MIN(op->x2, tile->x + tile->width);
+	y2 = MIN(op->y2, tile->y + tile->height);
+
+	for (row = y1; row < y2; row++) {
+		p = pixels + (row - tile->y) * tile->width + x1 - tile->x;
+		s = op->image + (row - op->y) * op->width + x1 - op->x;
+
+		if (op->alpha == 0xff) {
+			for (col = x1; col < x2; col++, p++, s++)
+				*p = raster_over(*s, *p);
+		} else {
+			for (col = x1; col < x2; col++, p++, s++)
+				*p = raster_over(raster_scale(*s, op->alpha),
+						 *p);
+		}
+	}
+}
+
+static void
+raster_render_tile(raster_job_t *job, raster_tile_t *tile)
+{
+	raster_t *raster = job->raster;
+	raster_cover_t cover;
+	raster_op_t *op;
+	guint32 *pixels, v;
+	guchar *p;
+	guint a;
+	int row, col;
+	int i;
+
+	pixels = g_new(guint32, tile->width * tile->height);
+
+	cover.width = tile->width;
+	cover.height = tile->height;
+	cover.stride = tile->width + 2;
+	cover.acc = g_new0(float, cover.stride * cover.height);
+
+	v = raster_scale(0xff000000 | raster->background,
+			 raster->background_alpha);
+	for (i = 0; i < tile->width * tile->height; i++)
+		pixels[i] = v;
+
+	for (i = 0; i < tile->ops->len; i++) {
+		op = g_ptr_array_index(tile->ops, i);
+
+		switch (op->type) {
+		case RASTER_OP_TRAPS:
+			raster_fill_traps(tile, &cover, pixels, op);
+			break;
+
+		case RASTER_OP_IMAGE:
+			raster_draw_image(tile, pixels, op);
+			break;
+		}
+	}
+
+	for (row = 0; row < tile->height; row++) {
+		p = job->data + (tile->y - job->y0 + row) * job->stride +
+		    tile->x * 4;
+
+		for (col = 0; col < tile->width; col++, p += 4) {
+			v = pixels[row * tile->width + col];
+			a = v >> 24;
+			if (0 == a) {
+				p[0] = p[1] = p[2] = p[3] = 0;
+				continue;
+			}
+
+			p[0] = (((v >> 16) & 0xff) * 255 + a / 2) / a;
+			p[1] = (((v >> 8) & 0xff) * 255 + a / 2) / a;
+			p[2] = ((v & 0xff) * 255 + a / 2) / a;
+			p[3] = a;
+		}
+	}
+
+	g_free(cover.acc);
+	g_free(pixels);
+}
+
+static void
+raster_tile_func(gpointer data, gpointer user_data)
+{
+	raster_render_tile(user_data, data);
+}
+
+int
+raster_nr_cpus(void)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (n > 0)
+		return n;
+#endif
+	return 1;
+}
+
+/*
+ * Rasterize rows y0 to y0 + height - 1 into data.  Every tile is
+ * drawn independently from the operations touching it, so the result
+ * neither depends on the number of threads nor on how the image is
+ * cut into strips.  nthreads 0 uses one thread per CPU.
+ */
+static int
+raster_render_rows(raster_t *raster, guchar *data, guint stride,
+		   int y0, int height, int nthreads)
+{
+	raster_tile_t *tiles, *tile;
+	GThreadPool *pool = NULL;
+	raster_job_t job;
+	raster_op_t *op;
+	GError *error;
+	int cols, rows;
+	int x, y, i;
+
+	cols = (raster->width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+	rows = (height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+
+	tiles = g_new(raster_tile_t, cols * rows);
+	for (y = 0; y < rows; y++) {
+		for (x = 0; x < cols; x++) {
+			tile = &tiles[y * cols + x];
+
+			tile->x = x * RASTER_TILE_SIZE;
+			tile->y = y0 + y * RASTER_TILE_SIZE;
+			tile->width = MIN(RASTER_TILE_SIZE,
+					  raster->width - tile->x);
+			tile->height = MIN(RASTER_TILE_SIZE,
+					   y0 + height - tile->y);
+			tile->ops = g_ptr_array_new();
+		}
+	}
+
+	for (i = 0; i < raster->ops->len; i++) {
+		op = g_ptr_array_index(raster->ops, i);
+
+		if (op->x1 >= op->x2 || op->y1 >= op->y2)
+			continue;
+		if (op->y2 <= y0 || op->y1 >= y0 + height)
+			continue;
+
+		for (y = (MAX(op->y1, y0) - y0) / RASTER_TILE_SIZE;
+		     y <= (MIN(op->y2, y0 + height) - 1 - y0) / RASTER_TILE_SIZE;
+		     y++) {
+			for (x = op->x1 / RASTER_TILE_SIZE;
+			     x <= (op->x2 - 1) / RASTER_TILE_SIZE; x++)
+				g_ptr_array_add(tiles[y * cols + x].ops, op);
+		}
+	}
+
+	if (nthreads <= 0)
+		nthreads = raster_nr_cpus();
+
+	job.raster = raster;
+	job.data = data;
+	job.stride = stride;
+	job.y0 = y0;
+
+	if (nthreads > 1 && g_thread_supported()) {
+		error = NULL;
+		pool = g_thread_pool_new(raster_tile_func, &job, nthreads,
+					 FALSE, &error);
+		if (NULL == pool) {
+			fprintf(stderr, "%s: g_thread_pool_new: %s\n",
+				__FUNCTION__, error->message);
+			g_error_free(error);
+		}
+	}
+
+	for (i = 0; i < cols * rows; i++) {
+		if (pool)
+			g_thread_pool_push(pool, &tiles[i], NULL);
+		else
+			raster_render_tile(&job, &tiles[i]);
+	}
+
+	if (pool)
+		g_thread_pool_free(pool, FALSE, TRUE);
+
+	for (i = 0; i < cols * rows; i++)
+		g_ptr_array_free(tiles[i].ops, TRUE);
+	g_free(tiles);
+
+	return 0;
+}
+
+/*
+ * Rasterize all operations into pixbuf (RGBA, raster size).
+ */
+int
+raster_render(raster_t *raster, GdkPixbuf *pixbuf, int nthreads)
+{
+	if (gdk_pixbuf_get_width(pixbuf) != raster->width ||
+	    gdk_pixbuf_get_height(pixbuf) != raster->height ||
+	    gdk_pixbuf_get_n_channels(pixbuf) != 4) {
+		fprintf(stderr, "%s: pixbuf does not match raster\n",
+			__FUNCTION__);
+		return -EINVAL;
+	}
+
+	return raster_render_rows(raster, gdk_pixbuf_get_pixels(pixbuf),
+				  gdk_pixbuf_get_rowstride(pixbuf),
+				  0, raster->height, nthreads);
+}
+
+/*
+ * Write the raster as PNG one strip of RASTER_STRIP_HEIGHT rows at a
+ * time, so memory use depends on the image width only.
+ */
+int
+raster_save_png(raster_t *raster, const char *filename, int nthreads)
+{
+	png_structp png;
+	png_infop info;
+	guchar *strip;
+	guint stride;
+	FILE *file;
+	int y, height, row;
+	int error = 0;
+
+	file = g_fopen(filename, "wb");
+	if (NULL == file) {
+		error = -errno;
+		fprintf(stderr, "%s: %s: %s\n", __FUNCTION__, filename,
+			strerror(errno));
+		return error;
+	}
+
+	png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if (NULL == png) {
+		fprintf(stderr, "%s: png_create_write_struct failed\n",
+			__FUNCTION__);
+		fclose(file);
+		return -ENOMEM;
+	}
+
+	info = png_create_info_struct(png);
+	if (NULL == info) {
+		fprintf(stderr, "%s: png_create_info_struct failed\n",
+			__FUNCTION__);
+		png_destroy_write_struct(&png, NULL);
+		fclose(file);
+		return -ENOMEM;
+	}
+
+	stride = raster->width * 4;
+	strip = g_try_malloc(stride * RASTER_STRIP_HEIGHT);
+	if (NULL == strip) {
+		fprintf(stderr, "%s: out of memory\n", __FUNCTION__);
+		png_destroy_write_struct(&png, &info);
+		fclose(file);
+		return -ENOMEM;
+	}
+
+	if (setjmp(png_jmpbuf(png))) {
+		fprintf(stderr, "%s: %s: error writing PNG\n",
+			__FUNCTION__, filename);
+		error = -EIO;
+		goto out;
+	}
+
+	png_init_io(png, file);
+	png_set_IHDR(png, info, raster->width, raster->height, 8,
+		     PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE,
+		     PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png, info);
+
+	for (y = 0; y < raster->height; y += RASTER_STRIP_HEIGHT) {
+		height = MIN(RASTER_STRIP_HEIGHT, raster->height - y);
+
+		raster_render_rows(raster, strip, stride, y, height, nthreads);
+
+		for (row = 0; row < height; row++)
+			png_write_row(png, strip + row * stride);
+	}
+
+	png_write_end(png, info);
+
+out:
+	png_destroy_write_struct(&png, &info);
+	g_free(strip);
+
+	if (fclose(file) && 0 == error) {
+		error = -errno;
+		fprintf(stderr, "%s: %s: %s\n", __FUNCTION__, filename,
+			strerror(errno));
+	}
+
+	return error;
+}
+
+/*
+ * Render thread.  Frames are handed over in two single slots, one
+ * from the UI to the worker and one back, by atomic exchange: a newer
+ * frame replaces one that has not been picked up yet.  The async queue
+ * only wakes the worker up.
+ */
+struct __raster_worker_s__ {
+	GThread		*thread;
+	GAsyncQueue	*wakeup;
+
+	gpointer	job;		/* raster_frame_t to render */
+	gpointer	done;		/* raster_frame_t rendered */
+
+	GSourceFunc	ready;
+	gpointer	data;
+};
+
+static raster_frame_t *
+raster_frame_exchange(gpointer *slot, raster_frame_t *frame)
+{
+	gpointer old;
+
+	do {
+		old = g_atomic_pointer_get(slot);
+	} while (!g_atomic_pointer_compare_and_exchange(slot, old, frame));
+
+	return old;
+}
+
+void
+raster_frame_free(raster_frame_t *frame)
+{
+	if (frame->raster)
+		raster_free(frame->raster);
+	if (frame->pixbuf)
+		g_object_unref(frame->pixbuf);
+	g_free(frame);
+}
+
+static gpointer
+raster_worker_thread(gpointer data)
+{
+	raster_worker_t *worker = data;
+	raster_frame_t *frame, *old;
+	raster_t *raster;
+
+	for (;;) {
+		g_async_queue_pop(worker->wakeup);
+
+		frame = raster_frame_exchange(&worker->job, NULL);
+		if (NULL == frame)
+			continue;
+
+		raster = frame->raster;
+		frame->pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, TRUE, 8,
+					       raster->width, raster->height);
+		if (NULL == frame->pixbuf ||
+		    raster_render(raster, frame->pixbuf, 1) < 0) {
+			fprintf(stderr, "%s: frame %lu not rendered\n",
+				__FUNCTION__, frame->seq);
+			raster_frame_free(frame);
+			continue;
+		}
+
+		raster_free(raster);
+		frame->raster = NULL;
+
+		old = raster_frame_exchange(&worker->done, frame);
+		if (old)
+			raster_frame_free(old);
+
+		g_idle_add(worker->ready, worker->data);
+	}
+
+	return NULL;
+}
+
+/*
+ * Start a render thread.  ready is called from the main loop whenever
+ * a frame has been rendered, and picks it up with raster_worker_take.
+ */
+raster_worker_t *
+raster_worker_new(GSourceFunc ready, gpointer data)
+{
+	raster_worker_t *worker;
+	GError *error = NULL;
+
+	worker = g_new0(raster_worker_t, 1);
+	worker->wakeup = g_async_queue_new();
+	worker->ready = ready;
+	worker->data = data;
+
+	worker->thread = g_thread_create(raster_worker_thread, worker,
+					 FALSE, &error);
+	if (NULL == worker->thread) {
+		fprintf(stderr, "%s: g_thread_create: %s\n",
+			__FUNCTION__, error->message);
+		g_error_free(error);
+		g_async_queue_unref(worker->wakeup);
+		g_free(worker);
+		return NULL;
+	}
+
+	return worker;
+}
+
+void
+raster_worker_submit(raster_worker_t *worker, raster_frame_t *frame)
+{
+	raster_frame_t *old;
+
+	old = raster_frame_exchange(&worker->job, frame);
+	if (old)
+		raster_frame_free(old);
+
+	g_async_queue_push(worker->wakeup, worker);
+}
+
+raster_frame_t *
+raster_worker_take(raster_worker_t *worker)
+{
+	return raster_frame_exchange(&worker->done, NULL);
+}
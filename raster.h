@@ -0,0 +1,77 @@
+/* $Id$
+ */
+
+#ifndef _RASTER_H
+#define _RASTER_H 1
+
+/*
+ * Recorded drawing operations of an offscreen image, rasterized
+ * later in tiles.  Include after "radar.h" (trapezoid_t).
+ */
+
+#define RASTER_TILE_SIZE	256
+#define RASTER_STRIP_HEIGHT	RASTER_TILE_SIZE
+
+enum raster_op_type {
+	RASTER_OP_TRAPS = 0,
+	RASTER_OP_IMAGE
+};
+
+typedef struct {
+	int		type;
+	int		x1, y1;		/* pixel bounds, x2/y2 exclusive */
+	int		x2, y2;
+
+	guint32		rgb;
+	guchar		alpha;
+
+	trapezoid_t	*traps;
+	int		ntraps;
+
+	guint32		*image;		/* premultiplied ARGB */
+	int		x, y;
+	int		width, height;
+} raster_op_t;
+
+struct __raster_s__ {
+	int		width;
+	int		height;
+
+	guint32		background;
+	guchar		background_alpha;
+
+	GPtrArray	*ops;
+};
+typedef struct __raster_s__ raster_t;
+
+raster_t *raster_new(int width, int height);
+void raster_free(raster_t *raster);
+
+PangoContext *raster_create_pango_context(void);
+
+void raster_fill(raster_t *raster, guint32 rgb, guchar alpha);
+int raster_add_traps(raster_t *raster, guint32 rgb, guchar alpha,
+		     GList *traps);
+int raster_add_trap_array(raster_t *raster, guint32 rgb, guchar alpha,
+			  const trapezoid_t *traps, int n);
+int raster_add_image(raster_t *raster, GdkPixbuf *pixbuf, int x, int y,
+		     guchar alpha);
+
+int raster_render(raster_t *raster, GdkPixbuf *pixbuf, int nthreads);
+int raster_save_png(raster_t *raster, const char *filename, int nthreads);
+int raster_nr_cpus(void);
+
+typedef struct {
+	raster_t	*raster;	/* recorded, freed once rendered */
+	GdkPixbuf	*pixbuf;	/* RGBA result */
+	unsigned long	seq;
+} raster_frame_t;
+
+typedef struct __raster_worker_s__ raster_worker_t;
+
+raster_worker_t *raster_worker_new(GSourceFunc ready, gpointer data);
+void raster_worker_submit(raster_worker_t *worker, raster_frame_t *frame);
+raster_frame_t *raster_worker_take(raster_worker_t *worker);
+void raster_frame_free(raster_frame_t *frame);
+
+#endif /* !(_RASTER_H) */